@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+#include "async_sink.h"
+#include "trace.h"
+
+// Waking the other side if it sleeps; the seq_cst publication before pairs with the flag store of the sleeper
+static void wake_parked(async_sink_t* async, atomic_bool* idle, pthread_cond_t* cond) {
+    if (atomic_load_explicit(idle, memory_order_seq_cst)) {
+        pthread_mutex_lock(&async->lock);
+        pthread_cond_signal(cond);
+        pthread_mutex_unlock(&async->lock);
+    }
+}
+
+// Waiting for the batch at tail, false once the ring is closed and empty
+static bool wait_for_batch(async_sink_t* async, unsigned tail) {
+    for (int spin = 0;; spin++) {
+        if (tail != atomic_load_explicit(&async->head, memory_order_acquire)) {
+            return true;
+        }
+        // Closing happens after the last publication, so head is read again
+        if (atomic_load_explicit(&async->closed, memory_order_acquire) &&
+            tail == atomic_load_explicit(&async->head, memory_order_acquire)) {
+            return false;
+        }
+        if (spin == 0) {
+            async->consumer_waits++;
+        }
+        if (spin < ASYNC_SINK_SPINS) {
+            sched_yield();
+            continue;
+        }
+
+        pthread_mutex_lock(&async->lock);
+        atomic_store_explicit(&async->consumer_idle, true, memory_order_seq_cst);
+        while (tail == atomic_load_explicit(&async->head, memory_order_seq_cst) &&
+               !atomic_load_explicit(&async->closed, memory_order_seq_cst)) {
+            async->consumer_parks++;
+            pthread_cond_wait(&async->not_empty, &async->lock);
+        }
+        atomic_store_explicit(&async->consumer_idle, false, memory_order_relaxed);
+        pthread_mutex_unlock(&async->lock);
+    }
+}
+
+// Waiting until the slot at head is free, false once the sink has failed
+static bool wait_for_slot(async_sink_t* async, unsigned head) {
+    for (int spin = 0;; spin++) {
+        if (head - atomic_load_explicit(&async->tail, memory_order_acquire) < ASYNC_SINK_SLOTS) {
+            return true;
+        }
+        if (atomic_load_explicit(&async->failed, memory_order_relaxed)) {
+            return false;
+        }
+        if (spin == 0) {
+            async->producer_waits++;
+        }
+        if (spin < ASYNC_SINK_SPINS) {
+            sched_yield();
+            continue;
+        }
+
+        // The writer frees a slot even for a failed batch, so the wait always ends
+        pthread_mutex_lock(&async->lock);
+        atomic_store_explicit(&async->producer_idle, true, memory_order_seq_cst);
+        while (head - atomic_load_explicit(&async->tail, memory_order_seq_cst) == ASYNC_SINK_SLOTS) {
+            async->producer_parks++;
+            pthread_cond_wait(&async->not_full, &async->lock);
+        }
+        atomic_store_explicit(&async->producer_idle, false, memory_order_relaxed);
+        pthread_mutex_unlock(&async->lock);
+    }
+}
+
+// Writer thread body: passing the published batches on until the ring is closed and empty
+static void* async_sink_worker(void* arg) {
+    async_sink_t* async = (async_sink_t*)arg;
+    unsigned tail = atomic_load_explicit(&async->tail, memory_order_relaxed);
+    set_trace_job(async->trace_job);
+    set_trace_thread_name("writer");
+
+    while (wait_for_batch(async, tail)) {
+        const sample_buffer_t* slot = &async->slots[tail % ASYNC_SINK_SLOTS];
+        if (!atomic_load_explicit(&async->failed, memory_order_relaxed) &&
+            !async->sink(async->context, slot->x_values, slot->y_values, slot->connected, slot->count)) {
+            atomic_store_explicit(&async->failed, true, memory_order_relaxed);
+        }
+        atomic_store_explicit(&async->tail, ++tail, memory_order_seq_cst);
+        wake_parked(async, &async->producer_idle, &async->not_full);
+    }
+    return NULL;
+}
+
+bool start_async_sink(async_sink_t* async, sample_sink_t sink, void* context) {
+    if (async == NULL || sink == NULL) {
+        return false;
+    }
+
+    memset(async, 0, sizeof(async_sink_t));
+    atomic_init(&async->head, 0);
+    atomic_init(&async->tail, 0);
+    atomic_init(&async->closed, false);
+    atomic_init(&async->failed, false);
+    atomic_init(&async->producer_idle, false);
+    atomic_init(&async->consumer_idle, false);
+    async->sink = sink;
+    async->context = context;
+    async->trace_job = current_trace_job();
+
+    for (int i = 0; i < ASYNC_SINK_SLOTS; i++) {
+        init_sample_buffer(&async->slots[i]);
+    }
+    for (int i = 0; i < ASYNC_SINK_SLOTS; i++) {
+        if (!reserve_sample_buffer(&async->slots[i], ASYNC_SINK_SLOT_SIZE)) {
+            for (int j = 0; j <= i; j++) {
+                free_sample_buffer(&async->slots[j]);
+            }
+            return false;
+        }
+    }
+
+    pthread_mutex_init(&async->lock, NULL);
+    pthread_cond_init(&async->not_full, NULL);
+    pthread_cond_init(&async->not_empty, NULL);
+    if (pthread_create(&async->thread, NULL, async_sink_worker, async) != 0) {
+        pthread_cond_destroy(&async->not_empty);
+        pthread_cond_destroy(&async->not_full);
+        pthread_mutex_destroy(&async->lock);
+        for (int i = 0; i < ASYNC_SINK_SLOTS; i++) {
+            free_sample_buffer(&async->slots[i]);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool async_sink_push(void* context, const double* x_values, const double* y_values,
+                     const bool* connected, int count) {
+    async_sink_t* async = (async_sink_t*)context;
+    unsigned head = atomic_load_explicit(&async->head, memory_order_relaxed);
+
+    for (int first = 0; first < count; first += ASYNC_SINK_SLOT_SIZE) {
+        int length = count - first < ASYNC_SINK_SLOT_SIZE ? count - first : ASYNC_SINK_SLOT_SIZE;
+
+        if (!wait_for_slot(async, head)) {
+            return false;
+        }
+
+        sample_buffer_t* slot = &async->slots[head % ASYNC_SINK_SLOTS];
+        memcpy(slot->x_values, x_values + first, length * sizeof(double));
+        memcpy(slot->y_values, y_values + first, length * sizeof(double));
+        memcpy(slot->connected, connected + first, length * sizeof(bool));
+        slot->count = length;
+        atomic_store_explicit(&async->head, ++head, memory_order_seq_cst);
+        wake_parked(async, &async->consumer_idle, &async->not_empty);
+    }
+    return !atomic_load_explicit(&async->failed, memory_order_relaxed);
+}
+
+bool stop_async_sink(async_sink_t* async) {
+    if (async == NULL) {
+        return false;
+    }
+
+    atomic_store_explicit(&async->closed, true, memory_order_seq_cst);
+    wake_parked(async, &async->consumer_idle, &async->not_empty);
+    pthread_join(async->thread, NULL);
+    pthread_cond_destroy(&async->not_empty);
+    pthread_cond_destroy(&async->not_full);
+    pthread_mutex_destroy(&async->lock);
+    for (int i = 0; i < ASYNC_SINK_SLOTS; i++) {
+        free_sample_buffer(&async->slots[i]);
+    }
+    return !atomic_load_explicit(&async->failed, memory_order_relaxed);
+}
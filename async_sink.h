@@ -0,0 +1,64 @@
+#ifndef ASYNC_SINK_H
+#define ASYNC_SINK_H
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "sampler.h"
+
+// Batches in flight between the sampler and the writer thread
+#define ASYNC_SINK_SLOTS 4
+
+// Points per slot, larger batches are split
+#define ASYNC_SINK_SLOT_SIZE SAMPLE_CHUNK_SIZE
+
+// Yields on a full or empty ring before the waiting side sleeps
+#define ASYNC_SINK_SPINS 64
+
+// Sink running on its own thread, fed through a single-producer/single-consumer ring
+typedef struct {
+    sample_buffer_t slots[ASYNC_SINK_SLOTS];
+    atomic_uint     head;           // batches published, written by the producer only
+    atomic_uint     tail;           // batches consumed, written by the consumer only
+    atomic_bool     closed;         // no more batches will be published
+    atomic_bool     failed;         // the sink refused a batch
+    atomic_bool     producer_idle;  // the producer sleeps on not_full
+    atomic_bool     consumer_idle;  // the writer sleeps on not_empty
+    pthread_mutex_t lock;           // only taken to park and to wake a parked side
+    pthread_cond_t  not_full;
+    pthread_cond_t  not_empty;
+    sample_sink_t   sink;           // called on the writer thread
+    void*           context;
+    pthread_t       thread;
+    long long       producer_waits; // times the ring was full
+    long long       consumer_waits; // times the ring was empty
+    long long       producer_parks; // times the producer slept
+    long long       consumer_parks; // times the writer slept
+    int             trace_job;      // job id of the spans of the writer thread
+} async_sink_t;
+
+/**
+ * @brief Starts the writer thread that passes the batches on to the sink.
+ *
+ * @param async Ring to initialize
+ * @param sink Sink called on the writer thread, in the order of the batches
+ * @param context Passed to the sink
+ * @return bool False if the buffers or the thread cannot be created.
+ *
+ * The producer copies each batch into a free slot and publishes it with a
+ * release store of head, the writer thread hands it to the sink and frees the
+ * slot with a release store of tail. While batches flow neither side takes a
+ * lock. A side that finds the ring full or empty yields the processor a few
+ * times, then sleeps on a condition variable; the other side only takes the
+ * lock to wake it when the sleeper flag is set.
+ */
+bool start_async_sink(async_sink_t* async, sample_sink_t sink, void* context);
+
+// Queueing a batch, a sample_sink_t with the ring as context; false once the sink has failed
+bool async_sink_push(void* context, const double* x_values, const double* y_values,
+                     const bool* connected, int count);
+
+// Waiting until every batch has reached the sink and releasing the ring, false if the sink failed
+bool stop_async_sink(async_sink_t* async);
+
+#endif // ASYNC_SINK_H
@@ -0,0 +1,345 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+#include "batch.h"
+#include "defs.h"
+#include "render.h"
+#include "parser_utils.h"
+#include "timing.h"
+#include "trace.h"
+
+// Status of a job whose output file is written by an earlier job of the same batch
+#define BATCH_DUPLICATE_OUTPUT (-1)
+
+// One line of the job list
+typedef struct {
+    char*  line;                            // copy of the line, the arguments point into it
+    char*  arguments[BATCH_MAX_ARGUMENTS];
+    int    num_arguments;                   // -1 if the line cannot be split
+    long   line_number;
+    int    status;
+    double latency_ms;
+} batch_job_t;
+
+// Jobs of one worker: the owner takes from the bottom, thieves from the top
+typedef struct {
+    int*            jobs;   // indices into the job array
+    int             top;
+    int             bottom;
+    pthread_mutex_t lock;
+} job_deque_t;
+
+// State shared by the workers
+typedef struct {
+    const program_options_t* options;
+    batch_job_t* jobs;
+    job_deque_t* deques;
+    int          num_workers;
+} batch_state_t;
+
+// Worker thread argument
+typedef struct {
+    batch_state_t* state;
+    int            index;
+    long           steals;  // jobs taken from other workers
+    render_cache_stats_t disk_cache; // lookups of --render-cache
+} batch_worker_t;
+
+// Reading the jobs of the list, returning their number or -1 on a read or allocation failure
+static int read_jobs(FILE* file, batch_job_t** jobs) {
+    char* line = NULL;
+    size_t line_capacity = 0;
+    long line_number = 0;
+    int count = 0;
+    int capacity = 0;
+    *jobs = NULL;
+
+    while (getline(&line, &line_capacity, file) != -1) {
+        line_number++;
+        char* first = line;
+        while (isspace((unsigned char)*first)) {
+            first++;
+        }
+        if (*first == END_STRING_CHAR || *first == '#') {
+            continue;
+        }
+
+        if (count == capacity) {
+            capacity = capacity == 0 ? BUFFER_SIZE : 2 * capacity;
+            batch_job_t* grown = (batch_job_t*)realloc(*jobs, capacity * sizeof(batch_job_t));
+            if (grown == NULL) {
+                count = -1;
+                break;
+            }
+            *jobs = grown;
+        }
+
+        batch_job_t* job = &(*jobs)[count];
+        memset(job, 0, sizeof(batch_job_t));
+        job->line = strdup(first);
+        if (job->line == NULL) {
+            count = -1;
+            break;
+        }
+        job->line_number = line_number;
+        job->num_arguments = split_arguments(job->line, job->arguments, BATCH_MAX_ARGUMENTS);
+        count++;
+    }
+    free(line);
+    return ferror(file) ? -1 : count;
+}
+
+// FNV-1a hash of an output path
+static unsigned long hash_path(const char* path) {
+    unsigned long hash = 14695981039346656037UL;
+    for (const unsigned char* c = (const unsigned char*)path; *c != END_STRING_CHAR; c++) {
+        hash = (hash ^ *c) * 1099511628211UL;
+    }
+    return hash;
+}
+
+// Failing every job whose output file an earlier job writes, with any number of workers, as
+// they would overwrite each other in parallel; false if memory is short
+static bool mark_duplicate_outputs(batch_job_t* jobs, int num_jobs) {
+    // Open addressing over the indices of the first jobs of each path, at most half full
+    size_t size = 16;
+    while (size < 2 * (size_t)num_jobs) {
+        size *= 2;
+    }
+    int* first_jobs = (int*)malloc(size * sizeof(int));
+    if (first_jobs == NULL) {
+        return false;
+    }
+    for (size_t slot = 0; slot < size; slot++) {
+        first_jobs[slot] = -1;
+    }
+
+    for (int i = 0; i < num_jobs; i++) {
+        if (jobs[i].num_arguments < 2 || jobs[i].status != SUCCESS) {
+            continue;
+        }
+        const char* output = jobs[i].arguments[1];
+        size_t slot = hash_path(output) & (size - 1);
+        while (first_jobs[slot] >= 0 && strcmp(jobs[first_jobs[slot]].arguments[1], output) != 0) {
+            slot = (slot + 1) & (size - 1);
+        }
+        if (first_jobs[slot] >= 0) {
+            jobs[i].status = BATCH_DUPLICATE_OUTPUT;
+        } else {
+            first_jobs[slot] = i;
+        }
+    }
+
+    free(first_jobs);
+    return true;
+}
+
+// Taking the next job of a worker, from its own deque or stolen from another one; -1 when all are empty
+static int take_job(batch_worker_t* worker) {
+    batch_state_t* state = worker->state;
+
+    job_deque_t* own = &state->deques[worker->index];
+    pthread_mutex_lock(&own->lock);
+    int job = own->bottom > own->top ? own->jobs[--own->bottom] : -1;
+    pthread_mutex_unlock(&own->lock);
+    if (job >= 0) {
+        return job;
+    }
+
+    // No job is ever added, so a full round over empty deques means the batch is done
+    for (int k = 1; k < state->num_workers; k++) {
+        job_deque_t* victim = &state->deques[(worker->index + k) % state->num_workers];
+        pthread_mutex_lock(&victim->lock);
+        job = victim->bottom > victim->top ? victim->jobs[victim->top++] : -1;
+        pthread_mutex_unlock(&victim->lock);
+        if (job >= 0) {
+            worker->steals++;
+            return job;
+        }
+    }
+    return -1;
+}
+
+// Rendering one job and printing its status line
+static void run_job(render_context_t* context, const program_options_t* options, batch_job_t* job, int number) {
+    set_trace_job(number);
+    unsigned long long span = begin_trace_span();
+    double start = monotonic_seconds();
+    if (job->status == SUCCESS) {
+        if (job->num_arguments < 2) {
+            job->status = ERROR_ARG_COUNT;
+        } else {
+            job->status = render_plot(context, options, job->arguments[0], job->arguments[1],
+                                      job->num_arguments == 3 ? job->arguments[2] : NULL);
+        }
+    }
+    job->latency_ms = (monotonic_seconds() - start) * 1e3;
+    end_trace_span("job", span, "line", job->line_number);
+    set_trace_job(0);
+
+    // One printf per line, stdio locks the stream for it
+    if (job->status == SUCCESS) {
+        printf("job %d (line %ld): ok, %s, %.2f ms\n", number, job->line_number, job->arguments[1], job->latency_ms);
+    } else if (job->status == BATCH_DUPLICATE_OUTPUT) {
+        printf("job %d (line %ld): error %d, %s is written by an earlier job\n",
+               number, job->line_number, ERROR_OUTPUT_FILE, job->arguments[1]);
+        job->status = ERROR_OUTPUT_FILE;
+    } else {
+        printf("job %d (line %ld): error %d, %s\n",
+               number, job->line_number, job->status, render_status_text(job->status));
+    }
+}
+
+// Worker thread body: rendering jobs until no deque has any left
+static void* batch_worker(void* arg) {
+    batch_worker_t* worker = (batch_worker_t*)arg;
+    batch_state_t* state = worker->state;
+
+    if (worker->index > 0) {
+        set_trace_thread_name("batch worker");
+    }
+    render_context_t context;
+    init_render_context(&context);
+    for (int job = take_job(worker); job >= 0; job = take_job(worker)) {
+        run_job(&context, state->options, &state->jobs[job], job + 1);
+    }
+    worker->disk_cache = context.disk_cache;
+    free_render_context(&context);
+    return NULL;
+}
+
+// Printing the summary, returning the number of failed jobs
+static int print_summary(const batch_job_t* jobs, int num_jobs, double elapsed,
+                         const batch_worker_t* workers, int num_workers) {
+    int num_failed = 0;
+    double* latencies = (double*)malloc((num_jobs > 0 ? num_jobs : 1) * sizeof(double));
+    for (int i = 0; i < num_jobs; i++) {
+        num_failed += jobs[i].status != SUCCESS;
+        if (latencies != NULL) {
+            latencies[i] = jobs[i].latency_ms;
+        }
+    }
+
+    long steals = 0;
+    render_cache_stats_t disk_cache = {0, 0, 0, 0};
+    for (int i = 0; i < num_workers; i++) {
+        steals += workers[i].steals;
+        disk_cache.hits      += workers[i].disk_cache.hits;
+        disk_cache.misses    += workers[i].disk_cache.misses;
+        disk_cache.stores    += workers[i].disk_cache.stores;
+        disk_cache.evictions += workers[i].disk_cache.evictions;
+    }
+
+    printf("Batch: %d jobs, %d failed, %d worker(s), %ld steals, %.3f s, %.1f jobs/s\n",
+           num_jobs, num_failed, num_workers, steals, elapsed, elapsed > 0 ? num_jobs / elapsed : 0.0);
+    if (latencies != NULL && num_jobs > 0) {
+        sort_durations(latencies, num_jobs);
+        printf("Latency: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+               duration_percentile(latencies, num_jobs, 50), duration_percentile(latencies, num_jobs, 90),
+               duration_percentile(latencies, num_jobs, 99), latencies[num_jobs - 1]);
+    }
+    if (disk_cache.hits + disk_cache.misses > 0) {
+        printf("Render cache: %lld hits, %lld misses, %lld stored, %lld evicted\n",
+               disk_cache.hits, disk_cache.misses, disk_cache.stores, disk_cache.evictions);
+    }
+    free(latencies);
+    return num_failed;
+}
+
+int run_batch(const char* path, const program_options_t* options) {
+    if (path == NULL || options == NULL) {
+        return ERROR_BATCH_INPUT;
+    }
+
+    bool from_stdin = strcmp(path, "-") == 0;
+    FILE* file = from_stdin ? stdin : fopen(path, "r");
+    if (file == NULL) {
+        perror("Error opening job list");
+        return ERROR_BATCH_INPUT;
+    }
+    batch_job_t* jobs = NULL;
+    unsigned long long span = begin_trace_span();
+    int num_jobs = read_jobs(file, &jobs);
+    end_trace_span("read_jobs", span, "jobs", num_jobs);
+    if (!from_stdin) {
+        fclose(file);
+    }
+    if (num_jobs < 0) {
+        fprintf(stderr, "Error: Reading the job list failed\n");
+        free(jobs);
+        return ERROR_BATCH_INPUT;
+    }
+
+    int num_workers = options->num_workers < 1 ? 1 : options->num_workers;
+    if (num_workers > num_jobs) {
+        num_workers = num_jobs > 0 ? num_jobs : 1;
+    }
+    bool marked = mark_duplicate_outputs(jobs, num_jobs);
+
+    // Dealing the jobs round-robin, so every worker starts with a mix
+    batch_state_t state = {options, jobs, NULL, num_workers};
+    batch_worker_t* workers = (batch_worker_t*)calloc(num_workers, sizeof(batch_worker_t));
+    pthread_t* threads = (pthread_t*)malloc(num_workers * sizeof(pthread_t));
+    state.deques = (job_deque_t*)calloc(num_workers, sizeof(job_deque_t));
+    int* indices = (int*)malloc((num_jobs > 0 ? num_jobs : 1) * sizeof(int));
+    if (!marked || workers == NULL || threads == NULL || state.deques == NULL || indices == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed in run_batch\n");
+        free(workers);
+        free(threads);
+        free(state.deques);
+        free(indices);
+        for (int i = 0; i < num_jobs; i++) {
+            free(jobs[i].line);
+        }
+        free(jobs);
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    int next_index = 0;
+    for (int w = 0; w < num_workers; w++) {
+        job_deque_t* deque = &state.deques[w];
+        deque->jobs = indices + next_index;
+        // Pushed in reverse, so each worker takes its jobs in list order
+        for (int job = num_jobs - 1; job >= 0; job--) {
+            if (job % num_workers == w) {
+                deque->jobs[deque->bottom++] = job;
+            }
+        }
+        next_index += deque->bottom;
+        pthread_mutex_init(&deque->lock, NULL);
+        workers[w].state = &state;
+        workers[w].index = w;
+    }
+
+    // The calling thread is worker 0, a failed start leaves the jobs to be stolen by the others
+    double start = monotonic_seconds();
+    int started = 0;
+    for (int w = 1; w < num_workers; w++) {
+        if (pthread_create(&threads[w], NULL, batch_worker, &workers[w]) != 0) {
+            fprintf(stderr, "Error: Could not start batch worker %d\n", w);
+            break;
+        }
+        ++started;
+    }
+    batch_worker(&workers[0]);
+    for (int w = 1; w <= started; w++) {
+        pthread_join(threads[w], NULL);
+    }
+    double elapsed = monotonic_seconds() - start;
+
+    int num_failed = print_summary(jobs, num_jobs, elapsed, workers, num_workers);
+
+    for (int w = 0; w < num_workers; w++) {
+        pthread_mutex_destroy(&state.deques[w].lock);
+    }
+    for (int i = 0; i < num_jobs; i++) {
+        free(jobs[i].line);
+    }
+    free(jobs);
+    free(indices);
+    free(state.deques);
+    free(threads);
+    free(workers);
+    return num_failed == 0 ? SUCCESS : ERROR_BATCH_FAILED;
+}
@@ -0,0 +1,36 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "parse_input.h"
+
+// Most arguments on a line of the job list: function, output file and limits
+#define BATCH_MAX_ARGUMENTS 3
+
+// Upper bound for --jobs
+#define BATCH_MAX_WORKERS 256
+
+/**
+ * @brief Renders every job of a job list in this process.
+ *
+ * @param path Job list, "-" reads standard input
+ * @param options Options applied to every job, num_workers of them run at once
+ * @return int SUCCESS, ERROR_BATCH_INPUT if the list cannot be read,
+ *             ERROR_BATCH_FAILED if any job failed.
+ *
+ * Each line holds the arguments of one plain run: function, output file and
+ * optional limits, separated by blanks. Arguments containing blanks are
+ * enclosed in single or double quotes. Empty lines and lines starting with
+ * '#' are skipped. One status line is printed per job as it finishes, then a
+ * summary with the number of failures, jobs per second and latency
+ * percentiles.
+ *
+ * The jobs are dealt round-robin to per-worker deques. A worker takes its
+ * next job from the bottom of its own deque and, once that is empty, steals
+ * from the top of the others, so a few expensive jobs do not hold up the
+ * rest. Each worker reuses its own sampling and writer buffers. A job whose
+ * output file an earlier job of the list already writes fails, with any
+ * number of workers.
+ */
+int run_batch(const char* path, const program_options_t* options);
+
+#endif // BATCH_H
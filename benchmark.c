@@ -0,0 +1,498 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "defs.h"
+#include "shuntingyard.h"
+#include "bytecode.h"
+#include "optimizer.h"
+#include "jit.h"
+#include "sampler.h"
+#include "postscriptexport.h"
+#include "timing.h"
+#include "heap_usage.h"
+
+// Untimed runs before the measured ones, then measured runs of every case
+#define BENCH_WARMUP 2
+#define BENCH_REPETITIONS 15
+
+// Parse and compile calls timed together, a single call is too short for the clock
+#define BENCH_PARSE_CALLS 100
+
+// Largest range still evaluated through the token queue, the reference evaluator is slow
+#define BENCH_QUEUE_MAX_POINTS 20000
+
+// Machine-readable results, one line per case, unless a path is given on the command line
+#define BENCH_RESULTS_FILE "bench-results.csv"
+
+// Grid sizes of the evaluation and export stages over [-10, 10], the default range has 20000 points
+static const int BENCH_RANGE_POINTS[] = {1000, 20000, 200000};
+static const size_t NUM_BENCH_RANGES = sizeof(BENCH_RANGE_POINTS) / sizeof(BENCH_RANGE_POINTS[0]);
+
+// Expressions in the normalized form produced by remove_spaces(), from trivial to deeply nested
+static const char* BENCH_EXPRESSIONS[] = {
+    "x",
+    "x^2+3*x+2",
+    "(sin(x)+cos(x))*5",
+    "sinh(x)*tan(x)",
+    "exp(x^2)/(1+exp(x^2))",
+    "sin(x)*sin(x)+cos(x)*sin(x)",
+    "((x+1)*(x-1)+(x+2)*(x-2))/((x+3)*(x-3)+1)",
+    "sin(cos(tan(x/7))+exp(-abs(x)/3))*ln(cosh(x/5)+2)",
+    "atan(sinh(sin(x)^2+cos(x/2)^3))^1.5+sqrt(abs(tanh(ln(x^2+1)-log(abs(x)+1))))"
+};
+static const size_t NUM_BENCH_EXPRESSIONS = sizeof(BENCH_EXPRESSIONS) / sizeof(BENCH_EXPRESSIONS[0]);
+
+// Dense range for the thread scaling run, [-10, 10] at a 1e-5 step
+#define SCALING_POINTS 2000000
+#define SCALING_EXPRESSION "(sin(x)+cos(x))*5"
+
+// Points of the curve written by the writer benchmark
+#define WRITER_POINTS 1000000
+
+// Timing of one case per unit, a point or a call
+typedef struct {
+    double median_ns;
+    double p95_ns;
+    double allocations;
+} measurement_t;
+
+// Body of a case, run BENCH_WARMUP + BENCH_REPETITIONS times
+typedef void (*bench_body_t)(void* context);
+
+// Results file, NULL if it cannot be written
+static FILE* results;
+
+// Keeps the evaluated values alive
+static volatile double bench_sink;
+
+// Running a case and taking the median and p95 of the repetitions
+static measurement_t measure(bench_body_t body, void* context, double units) {
+    for (int r = 0; r < BENCH_WARMUP; r++) {
+        body(context);
+    }
+
+    double durations[BENCH_REPETITIONS];
+    long long allocations = heap_allocation_calls();
+    for (int r = 0; r < BENCH_REPETITIONS; r++) {
+        double start = monotonic_seconds();
+        body(context);
+        durations[r] = (monotonic_seconds() - start) * 1e9 / units;
+    }
+    allocations = heap_allocation_calls() - allocations;
+
+    sort_durations(durations, BENCH_REPETITIONS);
+    measurement_t result = {duration_percentile(durations, BENCH_REPETITIONS, 50),
+                            duration_percentile(durations, BENCH_REPETITIONS, 95),
+                            allocations / (BENCH_REPETITIONS * units)};
+    return result;
+}
+
+// Printing a result line and adding it to the results file, mb_per_s is NAN where nothing is written
+static void report(const char* stage, const char* engine, long long units, const char* expression,
+                   const measurement_t* m, double mb_per_s) {
+    char throughput[32] = "-";
+    if (!isnan(mb_per_s)) {
+        snprintf(throughput, sizeof(throughput), "%.1f", mb_per_s);
+    }
+    printf("%-9s %-10s %8lld %12.2f %12.2f %9.3f %9s  %s\n",
+           stage, engine, units, m->median_ns, m->p95_ns, m->allocations, throughput, expression);
+    if (results != NULL) {
+        fprintf(results, "%s,\"%s\",%s,%lld,%.3f,%.3f,%.4f,%s\n", stage, expression, engine, units,
+                m->median_ns, m->p95_ns, m->allocations, isnan(mb_per_s) ? "" : throughput);
+    }
+}
+
+static void print_stage_header(const char* title, const char* unit) {
+    printf("\n%s\n%-9s %-10s %8s %12s %12s %9s %9s  %s\n", title, "stage", "engine", unit,
+           "median ns", "p95 ns", "allocs", "MB/s", "expression");
+}
+
+// Parse stage: one expression parsed, or parsed once and optimized and compiled
+typedef struct {
+    const char*       expression;
+    const TokenQueue* queue;
+} parse_context_t;
+
+static void parse_body(void* arg) {
+    parse_context_t* context = (parse_context_t*)arg;
+    for (int i = 0; i < BENCH_PARSE_CALLS; i++) {
+        TokenQueue queue;
+        init_token_queue(&queue);
+        parse_expression(context->expression, &queue);
+        clear_token_queue(&queue);
+    }
+}
+
+static void compile_body(void* arg) {
+    parse_context_t* context = (parse_context_t*)arg;
+    for (int i = 0; i < BENCH_PARSE_CALLS; i++) {
+        ExprNode* tree = optimize_expression(context->queue);
+        ExpressionProgram program;
+        if (tree != NULL && compile_expression_tree(tree, &program)) {
+            free_program(&program);
+        }
+        free_expression_tree(tree);
+    }
+}
+
+// Evaluation stage: one engine over the points of a range
+typedef struct {
+    const TokenQueue*        queue;
+    const ExpressionProgram* program;
+    const JitProgram*        jit;
+    const double*            xs;
+    double*                  ys;
+    int                      count;
+} eval_context_t;
+
+static void queue_body(void* arg) {
+    eval_context_t* context = (eval_context_t*)arg;
+    for (int i = 0; i < context->count; i++) {
+        context->ys[i] = evaluate_expression(context->queue, context->xs[i]);
+    }
+    bench_sink = context->ys[0];
+}
+
+static void scalar_body(void* arg) {
+    eval_context_t* context = (eval_context_t*)arg;
+    for (int i = 0; i < context->count; i++) {
+        context->ys[i] = evaluate_program(context->program, context->xs[i]);
+    }
+    bench_sink = context->ys[0];
+}
+
+static void batch_body(void* arg) {
+    eval_context_t* context = (eval_context_t*)arg;
+    evaluate_expression_batch(context->program, context->xs, context->ys, context->count);
+    bench_sink = context->ys[0];
+}
+
+static void jit_body(void* arg) {
+    eval_context_t* context = (eval_context_t*)arg;
+    jit_evaluate_batch(context->jit, context->xs, context->ys, context->count);
+    bench_sink = context->ys[0];
+}
+
+// Export stage: the sampled points of a range written by export_to_postscript()
+typedef struct {
+    const char*             filename;
+    const sample_buffer_t*  samples;
+    const char*             expression;
+    ps_export_options_t     options;
+} export_context_t;
+
+static void export_body(void* arg) {
+    export_context_t* context = (export_context_t*)arg;
+    char interval_label[100];
+    snprintf(interval_label, sizeof(interval_label), INTERVAL_STRING_FORMAT,
+             DEFAULT_MIN, DEFAULT_MAX, DEFAULT_MIN, DEFAULT_MAX);
+    export_to_postscript(context->filename, context->samples->x_values, context->samples->y_values,
+                         context->samples->connected, context->samples->count,
+                         DEFAULT_MIN, DEFAULT_MAX, DEFAULT_MIN, DEFAULT_MAX,
+                         context->expression, interval_label, &context->options);
+}
+
+// Timing parse_expression() and the optimizer with compilation for every expression
+static void run_parse_stage(void) {
+    print_stage_header("parse and compile, per call", "calls");
+    for (size_t e = 0; e < NUM_BENCH_EXPRESSIONS; e++) {
+        TokenQueue queue;
+        init_token_queue(&queue);
+        if (!parse_expression(BENCH_EXPRESSIONS[e], &queue)) {
+            fprintf(stderr, "Error: cannot parse '%s'\n", BENCH_EXPRESSIONS[e]);
+            clear_token_queue(&queue);
+            continue;
+        }
+
+        parse_context_t context = {BENCH_EXPRESSIONS[e], &queue};
+        measurement_t m = measure(parse_body, &context, BENCH_PARSE_CALLS);
+        report("parse", "shunting", BENCH_PARSE_CALLS, BENCH_EXPRESSIONS[e], &m, NAN);
+        m = measure(compile_body, &context, BENCH_PARSE_CALLS);
+        report("compile", "optimizer", BENCH_PARSE_CALLS, BENCH_EXPRESSIONS[e], &m, NAN);
+        clear_token_queue(&queue);
+    }
+}
+
+// Timing every evaluation engine per point over each range size
+static void run_evaluation_stage(void) {
+    print_stage_header("evaluation, per point", "points");
+    for (size_t s = 0; s < NUM_BENCH_RANGES; s++) {
+        int count = BENCH_RANGE_POINTS[s];
+        double* xs = (double*)malloc(count * sizeof(double));
+        double* ys = (double*)malloc(count * sizeof(double));
+        if (xs == NULL || ys == NULL) {
+            free(xs);
+            free(ys);
+            return;
+        }
+        for (int i = 0; i < count; i++) {
+            xs[i] = DEFAULT_MIN + i * (DEFAULT_MAX - DEFAULT_MIN) / count;
+        }
+
+        for (size_t e = 0; e < NUM_BENCH_EXPRESSIONS; e++) {
+            const char* expression = BENCH_EXPRESSIONS[e];
+            TokenQueue queue;
+            init_token_queue(&queue);
+            ExpressionProgram program;
+            if (!parse_expression(expression, &queue) || !compile_expression(&queue, &program)) {
+                fprintf(stderr, "Error: cannot compile '%s'\n", expression);
+                clear_token_queue(&queue);
+                continue;
+            }
+            eval_context_t context = {&queue, &program, NULL, xs, ys, count};
+            measurement_t m;
+
+            if (count <= BENCH_QUEUE_MAX_POINTS) {
+                m = measure(queue_body, &context, count);
+                report("evaluate", "queue", count, expression, &m, NAN);
+            }
+            m = measure(scalar_body, &context, count);
+            report("evaluate", "scalar", count, expression, &m, NAN);
+            m = measure(batch_body, &context, count);
+            report("evaluate", "batch", count, expression, &m, NAN);
+
+            // Batch evaluation after simplification and strength reduction, then its native code
+            ExprNode* tree = optimize_expression(&queue);
+            ExpressionProgram optimized;
+            if (tree != NULL && compile_expression_tree(tree, &optimized)) {
+                context.program = &optimized;
+                m = measure(batch_body, &context, count);
+                report("evaluate", "optimized", count, expression, &m, NAN);
+
+                JitProgram jit;
+                if (jit_compile(&optimized, &jit)) {
+                    context.jit = &jit;
+                    m = measure(jit_body, &context, count);
+                    report("evaluate", "jit", count, expression, &m, NAN);
+                    jit_free(&jit);
+                }
+                free_program(&optimized);
+            }
+            free_expression_tree(tree);
+            free_program(&program);
+            clear_token_queue(&queue);
+        }
+        free(xs);
+        free(ys);
+    }
+}
+
+// Timing export_to_postscript() per written point over each range size, plain and compact
+static void run_export_stage(void) {
+    char filename[] = "bench-export-XXXXXX";
+    int fd = mkstemp(filename);
+    if (fd < 0) {
+        perror("Error creating the export benchmark file");
+        return;
+    }
+    close(fd);
+
+    print_stage_header("export, per point written", "points");
+    sample_buffer_t samples;
+    init_sample_buffer(&samples);
+    for (size_t s = 0; s < NUM_BENCH_RANGES; s++) {
+        int count = BENCH_RANGE_POINTS[s];
+        for (size_t e = 0; e < NUM_BENCH_EXPRESSIONS; e++) {
+            const char* expression = BENCH_EXPRESSIONS[e];
+            TokenQueue queue;
+            init_token_queue(&queue);
+            ExpressionProgram program;
+            if (!parse_expression(expression, &queue) || !compile_expression(&queue, &program)) {
+                clear_token_queue(&queue);
+                continue;
+            }
+            sample_job_t job = {&program, NULL, DEFAULT_MIN, DEFAULT_MAX, (DEFAULT_MAX - DEFAULT_MIN) / count,
+                                DEFAULT_MIN, DEFAULT_MAX, count, 1, 0, true, NULL};
+            int kept = sample_expression(&job, &samples);
+            free_program(&program);
+            clear_token_queue(&queue);
+            if (kept <= 0) {
+                continue;
+            }
+
+            static const struct {
+                const char*        engine;
+                ps_path_encoding_t encoding;
+            } ENCODINGS[] = {{"absolute", PS_PATH_ABSOLUTE}, {"compact", PS_PATH_ARRAYS}};
+            for (size_t k = 0; k < sizeof(ENCODINGS) / sizeof(ENCODINGS[0]); k++) {
+                export_context_t context = {filename, &samples, expression, {0, ENCODINGS[k].encoding, 0}};
+                measurement_t m = measure(export_body, &context, kept);
+                struct stat info;
+                double bytes = stat(filename, &info) == 0 ? (double)info.st_size : NAN;
+                report("export", ENCODINGS[k].engine, kept, expression, &m, bytes / (m.median_ns * kept / 1e9) / 1e6);
+            }
+        }
+    }
+    free_sample_buffer(&samples);
+    unlink(filename);
+}
+
+// Thread scaling stage: one dense range sampled by the interpreter
+typedef struct {
+    const sample_job_t* job;
+    sample_buffer_t*    samples;
+} scaling_context_t;
+
+static void scaling_body(void* arg) {
+    scaling_context_t* context = (scaling_context_t*)arg;
+    sample_expression(context->job, context->samples);
+}
+
+// Measuring sample_expression() on a dense range for 1, 2, 4, ... threads
+static void run_thread_scaling(void) {
+    TokenQueue queue;
+    init_token_queue(&queue);
+    ExpressionProgram program;
+    if (!parse_expression(SCALING_EXPRESSION, &queue) || !compile_expression(&queue, &program)) {
+        fprintf(stderr, "Error: cannot compile '%s'\n", SCALING_EXPRESSION);
+        clear_token_queue(&queue);
+        return;
+    }
+
+    sample_buffer_t samples;
+    init_sample_buffer(&samples);
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = cores > 1 ? (int)cores : 1;
+    if (max_threads < 8) {
+        max_threads = 8;
+    }
+    if (max_threads > SAMPLER_MAX_THREADS) {
+        max_threads = SAMPLER_MAX_THREADS;
+    }
+
+    char title[100];
+    snprintf(title, sizeof(title), "thread scaling, per point, %ld online cores", cores);
+    print_stage_header(title, "points");
+
+    double single_ns = 0;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        sample_job_t job = {&program, NULL, DEFAULT_MIN, DEFAULT_MAX, (DEFAULT_MAX - DEFAULT_MIN) / SCALING_POINTS,
+                            DEFAULT_MIN, DEFAULT_MAX, SCALING_POINTS, threads, 0, true, NULL};
+        scaling_context_t context = {&job, &samples};
+        measurement_t m = measure(scaling_body, &context, SCALING_POINTS);
+        if (threads == 1) {
+            single_ns = m.median_ns;
+        }
+        char engine[32];
+        snprintf(engine, sizeof(engine), "threads=%d", threads);
+        report("threads", engine, SCALING_POINTS, SCALING_EXPRESSION, &m, NAN);
+        printf("%-9s %-10s %8s %12.2fx speedup\n", "", "", "", single_ns / m.median_ns);
+    }
+
+    free_sample_buffer(&samples);
+    free_program(&program);
+    clear_token_queue(&queue);
+}
+
+// Writer stage: a path written with fprintf or the buffered writer
+typedef struct {
+    FILE*         file;
+    const double* xs;
+    const double* ys;
+    bool          buffered;
+} writer_context_t;
+
+static void writer_body(void* arg) {
+    writer_context_t* context = (writer_context_t*)arg;
+    rewind(context->file);
+    if (ftruncate(fileno(context->file), 0) != 0) {
+        return;
+    }
+
+    if (!context->buffered) {
+        for (int i = 0; i < WRITER_POINTS; i++) {
+            fprintf(context->file, "%.2f %.2f lineto\n", context->xs[i], context->ys[i]);
+        }
+        fflush(context->file);
+        return;
+    }
+
+    ps_writer_t writer;
+    if (ps_writer_init(&writer, context->file, PS_WRITER_BUFFER_SIZE)) {
+        for (int i = 0; i < WRITER_POINTS; i++) {
+            ps_write_fixed2(&writer, context->xs[i]);
+            ps_write_bytes(&writer, " ", 1);
+            ps_write_fixed2(&writer, context->ys[i]);
+            ps_write_bytes(&writer, " lineto\n", 8);
+        }
+        ps_writer_close(&writer);
+    }
+    fflush(context->file);
+}
+
+// Writing a 1M-point path with fprintf and with the buffered writer, reporting MB/s
+static void run_writer_benchmark(void) {
+    double* xs = (double*)malloc(WRITER_POINTS * sizeof(double));
+    double* ys = (double*)malloc(WRITER_POINTS * sizeof(double));
+    FILE* old_file = tmpfile();
+    FILE* new_file = tmpfile();
+    if (xs == NULL || ys == NULL || old_file == NULL || new_file == NULL) {
+        free(xs);
+        free(ys);
+        if (old_file != NULL) fclose(old_file);
+        if (new_file != NULL) fclose(new_file);
+        return;
+    }
+    for (int i = 0; i < WRITER_POINTS; i++) {
+        xs[i] = -500 + i * 0.001;
+        ys[i] = 5 * sin(xs[i]);
+    }
+
+    print_stage_header("path writer, per point", "points");
+    writer_context_t old_context = {old_file, xs, ys, false};
+    measurement_t m = measure(writer_body, &old_context, WRITER_POINTS);
+    long old_bytes = ftell(old_file);
+    report("writer", "fprintf", WRITER_POINTS, "5*sin(x)", &m, old_bytes / (m.median_ns * WRITER_POINTS / 1e9) / 1e6);
+
+    writer_context_t new_context = {new_file, xs, ys, true};
+    m = measure(writer_body, &new_context, WRITER_POINTS);
+    long new_bytes = ftell(new_file);
+    report("writer", "buffered", WRITER_POINTS, "5*sin(x)", &m, new_bytes / (m.median_ns * WRITER_POINTS / 1e9) / 1e6);
+
+    // Both files must be identical
+    bool identical = old_bytes == new_bytes;
+    rewind(old_file);
+    rewind(new_file);
+    char old_chunk[BUFFER_SIZE];
+    char new_chunk[BUFFER_SIZE];
+    size_t n;
+    while (identical && (n = fread(old_chunk, 1, sizeof(old_chunk), old_file)) > 0) {
+        identical = fread(new_chunk, 1, n, new_file) == n && memcmp(old_chunk, new_chunk, n) == 0;
+    }
+    printf("output %s\n", identical ? "identical" : "DIFFERENT");
+
+    free(xs);
+    free(ys);
+    fclose(old_file);
+    fclose(new_file);
+}
+
+int main(int argc, char* argv[]) {
+    debug_output = false;
+
+    const char* results_path = argc > 1 ? argv[1] : BENCH_RESULTS_FILE;
+    results = fopen(results_path, "w");
+    if (results == NULL) {
+        perror("Error opening the results file");
+    } else {
+        fprintf(results, "stage,expression,engine,units,median_ns,p95_ns,allocations,mb_per_s\n");
+    }
+    printf("%d warmup runs, median and p95 of %d runs, times and allocation calls per unit\n",
+           BENCH_WARMUP, BENCH_REPETITIONS);
+
+    run_parse_stage();
+    run_evaluation_stage();
+    run_export_stage();
+    run_thread_scaling();
+    run_writer_benchmark();
+
+    if (results != NULL) {
+        fclose(results);
+        printf("\nresults written to %s\n", results_path);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,461 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "bytecode.h"
+#include "defs.h"
+#include "function_registry.h"
+#include "expression_tree.h"
+#include "expression_dag.h"
+#include "timing.h"
+
+// Mapping a binary operator character to its opcode, -1 if unknown
+static int operator_opcode(char op) {
+    switch (op) {
+        case OPERATOR_PLUS:     return OP_ADD;
+        case OPERATOR_MINUS:    return OP_SUB;
+        case OPERATOR_MULTIPLY: return OP_MUL;
+        case OPERATOR_DIVIDE:   return OP_DIV;
+        case OPERATOR_POWER:    return OP_POW;
+        default:                return -1;
+    }
+}
+
+// State of the DAG to bytecode emitter
+typedef struct {
+    ExpressionProgram*   program;
+    const ExpressionDag* dag;
+    int*                 slot_of;     // slot holding a node, -1 if not stored
+    int*                 constant_of; // constant pool index of a node, -1 if none
+    int                  depth;       // current value stack depth
+    bool                 ok;
+} Emitter;
+
+// Appending one instruction and tracking the stack depth
+static void emit_instruction(Emitter* emitter, OpCode code, int operand, int popped, int pushed) {
+    ExpressionProgram* program = emitter->program;
+
+    if (emitter->depth < popped) {
+        emitter->ok = false;
+        return;
+    }
+    emitter->depth += pushed - popped;
+    if (emitter->depth > program->max_depth) {
+        program->max_depth = emitter->depth;
+    }
+    if (program->max_depth > PROGRAM_MAX_STACK_DEPTH) {
+        emitter->ok = false;
+        return;
+    }
+
+    Instruction instruction = {(unsigned char)code, (unsigned short)operand};
+    program->code[program->length++] = instruction;
+}
+
+// Emitting a DAG node in postfix order, shared nodes are computed only once
+static void emit_node(Emitter* emitter, int index) {
+    if (!emitter->ok) {
+        return;
+    }
+
+    const DagNode* node = &emitter->dag->nodes[index];
+    ExpressionProgram* program = emitter->program;
+
+    if (emitter->slot_of[index] >= 0) {
+        emit_instruction(emitter, OP_LOAD, emitter->slot_of[index], 0, 1);
+        return;
+    }
+
+    switch (node->kind) {
+        case NODE_CONST:
+            if (emitter->constant_of[index] < 0) {
+                emitter->constant_of[index] = (int)program->num_constants;
+                program->constants[program->num_constants++] = node->value;
+            }
+            emit_instruction(emitter, OP_PUSH_CONST, emitter->constant_of[index], 0, 1);
+            return; // pushing a constant is as cheap as loading a slot
+        case NODE_VARIABLE:
+            emit_instruction(emitter, OP_PUSH_X, 0, 0, 1);
+            return;
+        case NODE_NEGATE:
+            emit_node(emitter, node->left);
+            emit_instruction(emitter, OP_NEG, 0, 1, 1);
+            break;
+        case NODE_RECIPROCAL:
+            emit_node(emitter, node->left);
+            emit_instruction(emitter, OP_RECIP, 0, 1, 1);
+            break;
+        case NODE_BINARY: {
+            int code = operator_opcode(node->op);
+            if (code < 0) {
+                fprintf(stderr, "Error: Unsupported operator '%c'.\n", node->op);
+                emitter->ok = false;
+                return;
+            }
+            emit_node(emitter, node->left);
+            emit_node(emitter, node->right);
+            emit_instruction(emitter, (OpCode)code, 0, 2, 1);
+            break;
+        }
+        case NODE_POLYNOMIAL: {
+            int first = (int)program->num_constants;
+            program->constants[program->num_constants++] = node->degree;
+            for (int i = 0; i <= node->degree; i++) {
+                program->constants[program->num_constants++] = node->coefficients[i];
+            }
+            emit_node(emitter, node->left);
+            emit_instruction(emitter, OP_HORNER, first, 1, 1);
+            break;
+        }
+        case NODE_FUNCTION: {
+            const FunctionInfo* info = get_function_info(node->func_id);
+            if (info == NULL) {
+                emitter->ok = false;
+                return;
+            }
+            emit_node(emitter, node->left);
+            emit_instruction(emitter, OP_FUNC, node->func_id, info->arity, 1);
+            break;
+        }
+    }
+
+    // Keeping a shared result for the next references, while slots last
+    if (node->uses > 1 && program->num_slots < PROGRAM_MAX_SLOTS) {
+        emitter->slot_of[index] = program->num_slots++;
+        emit_instruction(emitter, OP_STORE, emitter->slot_of[index], 0, 0);
+    }
+}
+
+// Counting the nodes of a tree
+static size_t count_nodes(const ExprNode* node) {
+    if (node == NULL) {
+        return 0;
+    }
+    return 1 + count_nodes(node->left) + count_nodes(node->right);
+}
+
+bool compile_expression_tree(const ExprNode* root, ExpressionProgram* program) {
+    if (root == NULL || program == NULL) {
+        return false;
+    }
+
+    memset(program, 0, sizeof(ExpressionProgram));
+
+    ExpressionDag dag;
+    if (!build_expression_dag(root, &dag)) {
+        return false;
+    }
+
+    // Every tree node becomes at most one instruction, plus one store per DAG node
+    size_t max_code = count_nodes(root) + dag.count;
+
+    // One constant per DAG node, polynomials also store their degree and coefficients
+    size_t max_constants = dag.count;
+    for (size_t i = 0; i < dag.count; i++) {
+        if (dag.nodes[i].kind == NODE_POLYNOMIAL) {
+            max_constants += dag.nodes[i].degree + 2;
+        }
+    }
+
+    Emitter emitter = {program, &dag, NULL, NULL, 0, true};
+    program->code        = (Instruction*)malloc(max_code * sizeof(Instruction));
+    program->constants   = (double*)malloc(max_constants * sizeof(double));
+    emitter.slot_of      = (int*)malloc(dag.count * sizeof(int));
+    emitter.constant_of  = (int*)malloc(dag.count * sizeof(int));
+    if (program->code == NULL || program->constants == NULL ||
+        emitter.slot_of == NULL || emitter.constant_of == NULL) {
+        emitter.ok = false;
+    } else {
+        for (size_t i = 0; i < dag.count; i++) {
+            emitter.slot_of[i] = emitter.constant_of[i] = -1;
+        }
+        emit_node(&emitter, dag.root);
+    }
+
+    free(emitter.slot_of);
+    free(emitter.constant_of);
+    free_expression_dag(&dag);
+
+    if (!emitter.ok || emitter.depth != 1) {
+        if (program->max_depth > PROGRAM_MAX_STACK_DEPTH) {
+            fprintf(stderr, "Error: Expression is too deeply nested.\n");
+        }
+        free_program(program);
+        return false;
+    }
+
+    return true;
+}
+
+bool compile_expression(const TokenQueue* queue, ExpressionProgram* program) {
+    if (queue == NULL || program == NULL) {
+        return false;
+    }
+
+    memset(program, 0, sizeof(ExpressionProgram));
+
+    ExprNode* tree = build_expression_tree(queue);
+    if (tree == NULL) {
+        fprintf(stderr, "Error: Malformed expression.\n");
+        return false;
+    }
+
+    bool success = compile_expression_tree(tree, program);
+    free_expression_tree(tree);
+    return success;
+}
+
+// Evaluating an OP_HORNER polynomial (degree, then coefficients) at t
+static inline double evaluate_horner(const double* polynomial, double t) {
+    int degree = (int)polynomial[0];
+    const double* coefficients = polynomial + 1;
+
+    double result = coefficients[0];
+    for (int i = 1; i <= degree; i++) {
+        result = fma(result, t, coefficients[i]);
+    }
+    return result;
+}
+
+double evaluate_program(const ExpressionProgram* program, double x) {
+    if (program == NULL || program->code == NULL) {
+        return NAN;
+    }
+
+    double stack[PROGRAM_MAX_STACK_DEPTH];
+    double slots[PROGRAM_MAX_SLOTS];
+    int top = -1;
+
+    ProgramProfile* profile = program->profile;
+    const Instruction* code = program->code;
+    for (size_t i = 0; i < program->length; i++) {
+        unsigned long long started = profile != NULL ? profile_ticks() : 0;
+        switch (code[i].code) {
+            case OP_PUSH_CONST:
+                stack[++top] = program->constants[code[i].operand];
+                break;
+            case OP_PUSH_X:
+                stack[++top] = x;
+                break;
+            case OP_ADD:
+                top--;
+                stack[top] = stack[top] + stack[top + 1];
+                break;
+            case OP_SUB:
+                top--;
+                stack[top] = stack[top] - stack[top + 1];
+                break;
+            case OP_MUL:
+                top--;
+                stack[top] = stack[top] * stack[top + 1];
+                break;
+            case OP_DIV:
+                top--;
+                // Division by zero yields NaN, as in calculate_operator()
+                stack[top] = stack[top + 1] == 0 ? NAN : stack[top] / stack[top + 1];
+                break;
+            case OP_POW:
+                top--;
+                stack[top] = pow(stack[top], stack[top + 1]);
+                break;
+            case OP_NEG:
+                stack[top] = -stack[top];
+                break;
+            case OP_RECIP:
+                stack[top] = 1.0 / stack[top];
+                break;
+            case OP_FUNC:
+                stack[top] = apply_function(code[i].operand, stack[top]);
+                break;
+            case OP_STORE:
+                slots[code[i].operand] = stack[top];
+                break;
+            case OP_LOAD:
+                stack[++top] = slots[code[i].operand];
+                break;
+            case OP_HORNER:
+                stack[top] = evaluate_horner(&program->constants[code[i].operand], stack[top]);
+                break;
+        }
+        if (profile != NULL) {
+            atomic_fetch_add_explicit(&profile->ticks[i], profile_ticks() - started, memory_order_relaxed);
+            atomic_fetch_add_explicit(&profile->points[i], 1, memory_order_relaxed);
+        }
+    }
+
+    return stack[0];
+}
+
+void evaluate_expression_batch(const ExpressionProgram* program, const double* xs, double* ys, size_t n) {
+    if (program == NULL || xs == NULL || ys == NULL) {
+        return;
+    }
+    if (program->code == NULL) {
+        for (size_t i = 0; i < n; i++) {
+            ys[i] = NAN;
+        }
+        return;
+    }
+
+    // Column-wise value stack, one row of EVAL_BLOCK_SIZE values per stack slot
+    double stack[PROGRAM_MAX_STACK_DEPTH][EVAL_BLOCK_SIZE];
+    double slots[PROGRAM_MAX_SLOTS][EVAL_BLOCK_SIZE];
+
+    ProgramProfile* profile = program->profile;
+    const Instruction* code = program->code;
+    for (size_t start = 0; start < n; start += EVAL_BLOCK_SIZE) {
+        size_t count = n - start < EVAL_BLOCK_SIZE ? n - start : EVAL_BLOCK_SIZE;
+        const double* x = xs + start;
+        int top = -1;
+
+        for (size_t i = 0; i < program->length; i++) {
+            unsigned long long started = profile != NULL ? profile_ticks() : 0;
+            double* restrict a       = NULL;
+            const double* restrict b = NULL;
+            if (code[i].code >= OP_ADD && code[i].code <= OP_POW) {
+                top--;
+                a = stack[top];
+                b = stack[top + 1];
+            } else {
+                if (code[i].code == OP_PUSH_CONST || code[i].code == OP_PUSH_X || code[i].code == OP_LOAD) {
+                    top++;
+                }
+                a = stack[top];
+            }
+
+            switch (code[i].code) {
+                case OP_PUSH_CONST: {
+                    double value = program->constants[code[i].operand];
+                    for (size_t j = 0; j < count; j++) a[j] = value;
+                    break;
+                }
+                case OP_PUSH_X:
+                    memcpy(a, x, count * sizeof(double));
+                    break;
+                case OP_ADD:
+                    for (size_t j = 0; j < count; j++) a[j] = a[j] + b[j];
+                    break;
+                case OP_SUB:
+                    for (size_t j = 0; j < count; j++) a[j] = a[j] - b[j];
+                    break;
+                case OP_MUL:
+                    for (size_t j = 0; j < count; j++) a[j] = a[j] * b[j];
+                    break;
+                case OP_DIV:
+                    for (size_t j = 0; j < count; j++) a[j] = b[j] == 0 ? NAN : a[j] / b[j];
+                    break;
+                case OP_POW:
+                    for (size_t j = 0; j < count; j++) a[j] = pow(a[j], b[j]);
+                    break;
+                case OP_NEG:
+                    for (size_t j = 0; j < count; j++) a[j] = -a[j];
+                    break;
+                case OP_RECIP:
+                    for (size_t j = 0; j < count; j++) a[j] = 1.0 / a[j];
+                    break;
+                case OP_FUNC:
+                    apply_function_batch(code[i].operand, a, count);
+                    break;
+                case OP_STORE:
+                    memcpy(slots[code[i].operand], a, count * sizeof(double));
+                    break;
+                case OP_LOAD:
+                    memcpy(a, slots[code[i].operand], count * sizeof(double));
+                    break;
+                case OP_HORNER: {
+                    const double* polynomial = &program->constants[code[i].operand];
+                    for (size_t j = 0; j < count; j++) a[j] = evaluate_horner(polynomial, a[j]);
+                    break;
+                }
+            }
+            if (profile != NULL) {
+                atomic_fetch_add_explicit(&profile->ticks[i], profile_ticks() - started, memory_order_relaxed);
+                atomic_fetch_add_explicit(&profile->points[i], count, memory_order_relaxed);
+            }
+        }
+
+        memcpy(ys + start, stack[0], count * sizeof(double));
+    }
+}
+
+Interval evaluate_program_interval(const ExpressionProgram* program, Interval x) {
+    if (program == NULL || program->code == NULL) {
+        return entire_interval();
+    }
+
+    Interval stack[PROGRAM_MAX_STACK_DEPTH];
+    Interval slots[PROGRAM_MAX_SLOTS];
+    int top = -1;
+
+    const Instruction* code = program->code;
+    for (size_t i = 0; i < program->length; i++) {
+        switch (code[i].code) {
+            case OP_PUSH_CONST: {
+                double value = program->constants[code[i].operand];
+                stack[++top] = isnan(value) ? empty_interval() : make_interval(value, value);
+                break;
+            }
+            case OP_PUSH_X:
+                stack[++top] = x;
+                break;
+            case OP_ADD:
+                top--;
+                stack[top] = interval_add(stack[top], stack[top + 1]);
+                break;
+            case OP_SUB:
+                top--;
+                stack[top] = interval_sub(stack[top], stack[top + 1]);
+                break;
+            case OP_MUL:
+                top--;
+                stack[top] = interval_mul(stack[top], stack[top + 1]);
+                break;
+            case OP_DIV:
+                top--;
+                stack[top] = interval_div(stack[top], stack[top + 1]);
+                break;
+            case OP_POW:
+                top--;
+                stack[top] = interval_pow(stack[top], stack[top + 1]);
+                break;
+            case OP_NEG:
+                stack[top] = interval_neg(stack[top]);
+                break;
+            case OP_RECIP:
+                stack[top] = interval_recip(stack[top]);
+                break;
+            case OP_FUNC:
+                stack[top] = apply_function_interval(code[i].operand, stack[top]);
+                break;
+            case OP_STORE:
+                slots[code[i].operand] = stack[top];
+                break;
+            case OP_LOAD:
+                stack[++top] = slots[code[i].operand];
+                break;
+            case OP_HORNER: {
+                const double* polynomial = &program->constants[code[i].operand];
+                int degree = (int)polynomial[0];
+                Interval t = stack[top];
+                Interval result = make_interval(polynomial[1], polynomial[1]);
+                for (int j = 1; j <= degree; j++) {
+                    result = interval_add(interval_mul(result, t), make_interval(polynomial[j + 1], polynomial[j + 1]));
+                }
+                stack[top] = result;
+                break;
+            }
+        }
+    }
+
+    return stack[0];
+}
+
+void free_program(ExpressionProgram* program) {
+    if (program == NULL) {
+        return;
+    }
+
+    free(program->code);
+    free(program->constants);
+    memset(program, 0, sizeof(ExpressionProgram));
+}
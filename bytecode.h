@@ -0,0 +1,136 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "shuntingyard.h"
+#include "expression_tree.h"
+#include "interval.h"
+
+// Upper bound for the value stack of a compiled program
+#define PROGRAM_MAX_STACK_DEPTH 64
+
+// Upper bound for temporary slots holding shared subexpressions
+#define PROGRAM_MAX_SLOTS 32
+
+// Number of points evaluated per opcode dispatch by the batch evaluator,
+// sized so that the live part of the value stack stays in L1/L2
+#define EVAL_BLOCK_SIZE 128
+
+// Opcodes of a compiled expression
+typedef enum {
+    OP_PUSH_CONST, // push constants[operand]
+    OP_PUSH_X,     // push the variable
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_POW,
+    OP_NEG,        // unary minus
+    OP_RECIP,      // 1 / top with IEEE division, +-inf at +-0 unlike OP_DIV
+    OP_FUNC,       // apply registry function with id operand
+    OP_STORE,      // copy the top of the stack into slot operand
+    OP_LOAD,       // push slot operand
+    OP_HORNER      // replace the top t by a polynomial in t, see below
+} OpCode;
+
+/*
+ * OP_HORNER reads its polynomial from the constant pool: constants[operand]
+ * holds the degree n, the next n + 1 entries the coefficients from the
+ * highest degree down. It is evaluated as n nested fma() calls.
+ */
+
+// One compact instruction of a compiled expression
+typedef struct {
+    unsigned char  code;    // OpCode
+    unsigned short operand; // constant index, function id or slot
+} Instruction;
+
+// Counters per instruction, filled by the interpreter while attached to a program
+typedef struct {
+    atomic_ullong* ticks;  // profile_ticks() spent in each instruction
+    atomic_ullong* points; // points each instruction was executed for
+} ProgramProfile;
+
+// Flat program compiled from the expression DAG
+typedef struct {
+    Instruction* code;          // contiguous instruction array
+    size_t       length;        // number of instructions
+    double*      constants;     // constant pool
+    size_t       num_constants; // number of constants
+    int          max_depth;     // maximum value stack depth reached
+    int          num_slots;     // temporary slots used by OP_STORE/OP_LOAD
+    ProgramProfile* profile;    // counters of --profile-eval, NULL when not profiling
+} ExpressionProgram;
+
+/**
+ * @brief Compiles an expression tree into a flat program.
+ *
+ * @param root Expression tree, e.g. produced by optimize_expression()
+ * @param program Program to fill
+ * @return true if successful, false if the tree is too deep.
+ *
+ * The tree is lifted into a hash-consed DAG first: a subexpression that
+ * occurs several times is computed once, stored in a slot and reloaded.
+ * Evaluation dispatches functions by registry id, never touches strings
+ * and never allocates memory.
+ */
+bool compile_expression_tree(const ExprNode* root, ExpressionProgram* program);
+
+/**
+ * @brief Compiles an RPN token queue into a flat program without optimizing it.
+ *
+ * @param queue Token queue produced by parse_expression()
+ * @param program Program to fill
+ * @return true if successful, false if the queue is malformed or too deep.
+ *
+ * Equivalent to compile_expression_tree() on the tree of the queue, so the
+ * program computes exactly what evaluate_expression() computes.
+ */
+bool compile_expression(const TokenQueue* queue, ExpressionProgram* program);
+
+/**
+ * @brief Evaluates a compiled program for a single x.
+ *
+ * @param program Program produced by compile_expression()
+ * @param x Value of the variable
+ * @return double Result of the expression, NaN outside the domain.
+ *
+ * With a profile attached, every instruction adds its ticks and one point to it.
+ */
+double evaluate_program(const ExpressionProgram* program, double x);
+
+/**
+ * @brief Evaluates a compiled program for an array of x values.
+ *
+ * @param program Program produced by compile_expression()
+ * @param xs Input x values
+ * @param ys Output array receiving n results
+ * @param n Number of points
+ *
+ * Points are processed in blocks of EVAL_BLOCK_SIZE, each opcode runs as a
+ * tight loop over the whole block. Results are identical to evaluate_program().
+ * With a profile attached, every instruction adds its ticks and the block
+ * size to it, atomically so that sampling threads can share the profile.
+ */
+void evaluate_expression_batch(const ExpressionProgram* program, const double* xs, double* ys, size_t n);
+
+/**
+ * @brief Encloses the values of a compiled program over an interval of x.
+ *
+ * @param program Program produced by compile_expression()
+ * @param x Range of the variable
+ * @return Interval Enclosure of every defined result, empty if the program
+ *                  is undefined for the whole range.
+ *
+ * Each opcode is replaced by its interval rule, functions by the interval
+ * kernels of the registry. The enclosure may be much wider than the true
+ * range, but never misses a value evaluate_program() can produce.
+ */
+Interval evaluate_program_interval(const ExpressionProgram* program, Interval x);
+
+// Releases memory owned by a compiled program
+void free_program(ExpressionProgram* program);
+
+#endif // BYTECODE_H
@@ -0,0 +1,104 @@
+#include <string.h>
+#include <math.h>
+#include "decimation.h"
+#include "postscriptexport.h"
+
+// Starting a run at input position i
+static void start_run(column_run_t* run, long long column, long long i, double x, double y, bool connected) {
+    run->column    = column;
+    run->connected = connected;
+    for (int k = 0; k < RUN_POINTS; k++) {
+        run->index[k] = i;
+        run->x[k]     = x;
+        run->y[k]     = y;
+    }
+}
+
+// Handing the batch to the sink
+static void flush_decimated(decimator_t* decimator) {
+    if (decimator->count > 0 && !decimator->failed &&
+        !decimator->sink(decimator->context, decimator->x_values, decimator->y_values,
+                         decimator->connected, decimator->count)) {
+        decimator->failed = true;
+    }
+    decimator->count = 0;
+}
+
+// Passing on the distinct points of the run in their original order
+static void flush_run(decimator_t* decimator) {
+    const column_run_t* run = &decimator->run;
+    int min_first = run->index[RUN_MIN] < run->index[RUN_MAX];
+    int order[RUN_POINTS] = {RUN_FIRST, min_first ? RUN_MIN : RUN_MAX, min_first ? RUN_MAX : RUN_MIN, RUN_LAST};
+
+    for (int k = 0; k < RUN_POINTS; k++) {
+        if (k > 0 && run->index[order[k]] == run->index[order[k - 1]]) {
+            continue;
+        }
+        if (decimator->count == DECIMATION_BATCH_SIZE) {
+            flush_decimated(decimator);
+        }
+        decimator->x_values[decimator->count]  = run->x[order[k]];
+        decimator->y_values[decimator->count]  = run->y[order[k]];
+        decimator->connected[decimator->count] = k == 0 ? run->connected : true;
+        decimator->count++;
+        decimator->kept++;
+    }
+}
+
+void init_decimator(decimator_t* decimator, double x_min, double x_max, double columns_per_unit,
+                    sample_sink_t sink, void* context) {
+    memset(decimator, 0, sizeof(decimator_t));
+    decimator->x_min   = x_min;
+    decimator->scale   = columns_per_unit * GRAPH_SCALE / (x_max - x_min);
+    decimator->sink    = sink;
+    decimator->context = context;
+}
+
+bool decimate_points(decimator_t* decimator, const double* x_values, const double* y_values,
+                     const bool* connected, int count) {
+    if (decimator == NULL || x_values == NULL || y_values == NULL || connected == NULL) {
+        return false;
+    }
+
+    column_run_t* run = &decimator->run;
+    for (int i = 0; i < count; i++) {
+        double x = x_values[i];
+        double y = y_values[i];
+        long long column = (long long)floor((x - decimator->x_min) * decimator->scale);
+        long long position = decimator->received++;
+
+        if (position == 0 || !connected[i] || column != run->column) {
+            if (position > 0) {
+                flush_run(decimator);
+            }
+            start_run(run, column, position, x, y, connected[i]);
+            continue;
+        }
+
+        if (y < run->y[RUN_MIN]) {
+            run->index[RUN_MIN] = position;
+            run->x[RUN_MIN]     = x;
+            run->y[RUN_MIN]     = y;
+        }
+        if (y > run->y[RUN_MAX]) {
+            run->index[RUN_MAX] = position;
+            run->x[RUN_MAX]     = x;
+            run->y[RUN_MAX]     = y;
+        }
+        run->index[RUN_LAST] = position;
+        run->x[RUN_LAST]     = x;
+        run->y[RUN_LAST]     = y;
+    }
+    return !decimator->failed;
+}
+
+bool finish_decimation(decimator_t* decimator) {
+    if (decimator == NULL) {
+        return false;
+    }
+    if (decimator->received > 0) {
+        flush_run(decimator);
+    }
+    flush_decimated(decimator);
+    return !decimator->failed;
+}
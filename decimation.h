@@ -0,0 +1,66 @@
+#ifndef DECIMATION_H
+#define DECIMATION_H
+
+#include "sampler.h"
+
+// Default number of columns per device unit (point) of the graph
+#define DECIMATION_COLUMNS_PER_UNIT 1.0
+
+// Points collected before they are handed on
+#define DECIMATION_BATCH_SIZE 1024
+
+// Positions of the kept points of a run
+enum { RUN_FIRST, RUN_MIN, RUN_MAX, RUN_LAST, RUN_POINTS };
+
+// Run of connected points in one column, the kept points are copied out of the input
+typedef struct {
+    long long column;
+    long long index[RUN_POINTS]; // input positions of first, min, max and last
+    double    x[RUN_POINTS];
+    double    y[RUN_POINTS];
+    bool      connected;         // pen flag of the first point
+} column_run_t;
+
+// Decimation state, points arrive in batches and the kept ones go on to the sink
+typedef struct {
+    double        x_min;
+    double        scale;      // columns per unit of x
+    column_run_t  run;        // run being collected
+    long long     received;   // points received so far
+    long long     kept;       // points handed on so far
+    sample_sink_t sink;
+    void*         context;
+    double        x_values[DECIMATION_BATCH_SIZE];
+    double        y_values[DECIMATION_BATCH_SIZE];
+    bool          connected[DECIMATION_BATCH_SIZE];
+    int           count;      // points waiting in the batch
+    bool          failed;     // the sink refused a batch
+} decimator_t;
+
+/**
+ * @brief Prepares the reduction of the sampled points to at most four per device column (M4).
+ *
+ * @param decimator State to initialize
+ * @param x_min Left edge of the graph
+ * @param x_max Right edge of the graph
+ * @param columns_per_unit Columns per device unit, GRAPH_SCALE units span the graph
+ * @param sink Receiver of the kept points
+ * @param context Passed to the sink
+ *
+ * Each run of connected points falling into the same column keeps only its
+ * first, minimum, maximum and last point, in their original order. Pen
+ * lifts start a new run, so gaps in the graph are preserved. The rendered
+ * path is the same at the chosen resolution. Single streaming pass, a run
+ * may continue across batches.
+ */
+void init_decimator(decimator_t* decimator, double x_min, double x_max, double columns_per_unit,
+                    sample_sink_t sink, void* context);
+
+// Feeding sampled points in x order, false once the sink has refused a batch
+bool decimate_points(decimator_t* decimator, const double* x_values, const double* y_values,
+                     const bool* connected, int count);
+
+// Handing on the last run, false if the sink refused a batch
+bool finish_decimation(decimator_t* decimator);
+
+#endif // DECIMATION_H
@@ -1,18 +1,15 @@
 #ifndef DEFS_H
 #define DEFS_H
 
+#include <stdio.h>
+#include <stdbool.h>
+
 #define DEFAULT_MIN (-10.0)
 #define DEFAULT_MAX  10.0
 
 
 extern const char VALID_OPERATORS[];
 
-extern const char* VALID_FUNCTIONS[];
-// number of elements in the VALID_FUNCTIONS array.
-
-extern const size_t NUM_VALID_FUNCTIONS;
-
-
 #define VALID_VARIABLE 'x'
 
 // Operators
@@ -31,7 +28,11 @@ extern const size_t NUM_VALID_FUNCTIONS;
 
 #define BUFFER_SIZE 1024
 
-// Allowed functions
+// Diagnostic output, on by default and switched off in batch mode
+extern bool debug_output;
+#define DEBUG_PRINTF(...) do { if (debug_output) printf(__VA_ARGS__); } while (0)
+
+// Built-in functions, see function_registry.c
 #define FUNC_ABS  "abs"
 #define FUNC_EXP  "exp"
 #define FUNC_LN   "ln"
@@ -45,6 +46,7 @@ extern const size_t NUM_VALID_FUNCTIONS;
 #define FUNC_SINH "sinh"
 #define FUNC_COSH "cosh"
 #define FUNC_TANH "tanh"
+#define FUNC_SQRT "sqrt"
 
 #define DECIMAL_POINT  '.'
 #define MINUS_SIGN     '-'
@@ -57,6 +59,8 @@ extern const size_t NUM_VALID_FUNCTIONS;
 #define END_STRING_CHAR '\0'
 
 #define X_STEP_VALUE 0.001
+// Points evaluated per batch call in the sampling loop (x and y fit in L1)
+#define SAMPLE_BLOCK_SIZE 1024
 #define ABOUT_ZERO_CONST 1e-7
 
 #endif
\ No newline at end of file
@@ -0,0 +1,289 @@
+#include <stdlib.h>
+#include <string.h>
+#include "eval_profile.h"
+#include "defs.h"
+#include "function_registry.h"
+
+// Subterm of a program read back from its instructions
+typedef struct {
+    char*     text;     // infix form, NULL after an allocation failure
+    bool      atomic;   // needs no parentheses as an operand
+    bool      listed;   // false for constants, x and reloaded slots
+    int       left;     // listed operands, -1 for none
+    int       right;
+    int       slot;     // slot the result is stored in, -1 if not shared
+    unsigned long long self;  // ticks of the operation and of the unlisted operands
+    unsigned long long total; // ticks including the operands
+} subterm_t;
+
+// Names of the opcodes in the report
+static const char* OPCODE_NAMES[] = {
+    "constant", "x", "+", "-", "*", "/", "^", "negate", "reciprocal", "function", "store", "load", "polynomial"
+};
+
+bool init_program_profile(ProgramProfile* profile, const ExpressionProgram* program) {
+    profile->ticks  = (atomic_ullong*)calloc(program->length, sizeof(atomic_ullong));
+    profile->points = (atomic_ullong*)calloc(program->length, sizeof(atomic_ullong));
+    if (profile->ticks == NULL || profile->points == NULL) {
+        free_program_profile(profile);
+        return false;
+    }
+    return true;
+}
+
+void free_program_profile(ProgramProfile* profile) {
+    free(profile->ticks);
+    free(profile->points);
+    profile->ticks  = NULL;
+    profile->points = NULL;
+}
+
+// Formatting a new string, NULL if an argument is NULL or memory is short
+static char* format_text(const char* format, const char* a, const char* b) {
+    if (a == NULL || b == NULL) {
+        return NULL;
+    }
+    size_t size = strlen(format) + strlen(a) + strlen(b) + 1;
+    char* text = (char*)malloc(size);
+    if (text != NULL) {
+        snprintf(text, size, format, a, b);
+    }
+    return text;
+}
+
+// Operand text, parenthesized unless atomic
+static char* operand_text(const subterm_t* term) {
+    return format_text(term->atomic ? "%s%s" : "(%s)%s", term->text, "");
+}
+
+// Text of an OP_HORNER polynomial in t, highest degree first
+static char* polynomial_text(const double* polynomial, const subterm_t* argument) {
+    char* t = operand_text(argument);
+    if (t == NULL) {
+        return NULL;
+    }
+
+    // Each term is a coefficient, "*t" and "^degree"
+    int degree = (int)polynomial[0];
+    size_t size = (size_t)(degree + 1) * (strlen(t) + 40);
+    char* text = (char*)malloc(size);
+    if (text != NULL) {
+        size_t used = 0;
+        text[0] = '\0';
+        for (int i = 0; i <= degree; i++) {
+            double coefficient = polynomial[i + 1];
+            int power = degree - i;
+            if (coefficient == 0 && (used > 0 || power > 0)) {
+                continue;
+            }
+            used += snprintf(text + used, size - used, "%s%g", used > 0 && coefficient >= 0 ? "+" : "", coefficient);
+            if (power > 0) {
+                used += snprintf(text + used, size - used, "*%s", t);
+            }
+            if (power > 1) {
+                used += snprintf(text + used, size - used, "^%d", power);
+            }
+        }
+    }
+    free(t);
+    return text;
+}
+
+// Adding the cost of an operand, unlisted operands are folded into the operation
+static void add_operand(subterm_t* term, int* link, const subterm_t* terms, int operand) {
+    term->total += terms[operand].total;
+    if (terms[operand].listed) {
+        *link = operand;
+    } else {
+        term->self += terms[operand].total;
+    }
+}
+
+// Printing a listed subterm and its listed operands, indented by depth
+static void print_subterm(FILE* file, const subterm_t* terms, int index, int depth, unsigned long long all) {
+    const subterm_t* term = &terms[index];
+    const char* text = term->text != NULL ? term->text : "?";
+    int width = EVAL_PROFILE_TEXT_WIDTH - 2 * depth;
+    int length = (int)strlen(text);
+
+    fprintf(file, "%6.1f%% %6.1f%%  %*s", 100.0 * term->total / all, 100.0 * term->self / all, 2 * depth, "");
+    if (length > width) {
+        fprintf(file, "%.*s...", width - 3, text);
+    } else {
+        fprintf(file, "%s", text);
+    }
+    if (term->slot >= 0) {
+        fprintf(file, "  [shared t%d]", term->slot);
+    }
+    fprintf(file, "\n");
+
+    if (term->left >= 0) {
+        print_subterm(file, terms, term->left, depth + 1, all);
+    }
+    if (term->right >= 0) {
+        print_subterm(file, terms, term->right, depth + 1, all);
+    }
+}
+
+// Printing the ticks of each opcode, functions separately by name
+static void print_operations(FILE* file, const ExpressionProgram* program, const ProgramProfile* profile,
+                             unsigned long long all) {
+    int count = OP_HORNER + 1 + MAX_REGISTERED_FUNCTIONS;
+    unsigned long long ticks[OP_HORNER + 1 + MAX_REGISTERED_FUNCTIONS] = {0};
+    unsigned long long points[OP_HORNER + 1 + MAX_REGISTERED_FUNCTIONS] = {0};
+    int instructions[OP_HORNER + 1 + MAX_REGISTERED_FUNCTIONS] = {0};
+
+    for (size_t i = 0; i < program->length; i++) {
+        const Instruction* instruction = &program->code[i];
+        int row = instruction->code == OP_FUNC ? OP_HORNER + 1 + instruction->operand : instruction->code;
+        ticks[row]  += atomic_load_explicit(&profile->ticks[i], memory_order_relaxed);
+        points[row] += atomic_load_explicit(&profile->points[i], memory_order_relaxed);
+        instructions[row]++;
+    }
+
+    fprintf(file, "%-12s %6s %14s %12s %8s\n", "operation", "instr", "executions", "ticks/exec", "share");
+    for (int row = 0; row < count; row++) {
+        if (instructions[row] == 0) {
+            continue;
+        }
+        const char* name = row <= OP_HORNER ? OPCODE_NAMES[row] : get_function_info(row - OP_HORNER - 1)->name;
+        fprintf(file, "%-12s %6d %14llu %12.1f %7.1f%%\n", name, instructions[row], points[row],
+                points[row] > 0 ? (double)ticks[row] / points[row] : 0.0, 100.0 * ticks[row] / all);
+    }
+}
+
+void print_program_profile(FILE* file, const ExpressionProgram* program, const ProgramProfile* profile) {
+    if (program == NULL || profile == NULL || program->length == 0) {
+        return;
+    }
+
+    subterm_t* terms = (subterm_t*)calloc(program->length, sizeof(subterm_t));
+    if (terms == NULL) {
+        return;
+    }
+
+    // Running the program symbolically, each value on the stack is a subterm
+    int stack[PROGRAM_MAX_STACK_DEPTH];
+    int slot_term[PROGRAM_MAX_SLOTS];
+    int top = -1;
+    int count = 0;
+    unsigned long long all = 0;
+    unsigned long long evaluated = 0;
+
+    for (size_t i = 0; i < program->length; i++) {
+        const Instruction* instruction = &program->code[i];
+        unsigned long long ticks = atomic_load_explicit(&profile->ticks[i], memory_order_relaxed);
+        all += ticks;
+        if (i == 0) {
+            evaluated = atomic_load_explicit(&profile->points[i], memory_order_relaxed);
+        }
+
+        if (instruction->code == OP_STORE) {
+            subterm_t* stored = &terms[stack[top]];
+            stored->self  += ticks;
+            stored->total += ticks;
+            stored->slot   = instruction->operand;
+            slot_term[instruction->operand] = stack[top];
+            continue;
+        }
+
+        subterm_t* term = &terms[count];
+        term->left  = term->right = term->slot = -1;
+        term->self  = term->total = ticks;
+        term->listed = true;
+
+        switch (instruction->code) {
+            case OP_PUSH_CONST: {
+                char value[32];
+                snprintf(value, sizeof(value), "%g", program->constants[instruction->operand]);
+                term->text   = format_text("%s%s", value, "");
+                term->atomic = program->constants[instruction->operand] >= 0;
+                term->listed = false;
+                break;
+            }
+            case OP_PUSH_X:
+                term->text   = format_text("%s%s", "x", "");
+                term->atomic = true;
+                term->listed = false;
+                break;
+            case OP_LOAD: {
+                const subterm_t* stored = &terms[slot_term[instruction->operand]];
+                term->text   = format_text("%s%s", stored->text, "");
+                term->atomic = stored->atomic;
+                term->listed = false;
+                break;
+            }
+            case OP_ADD:
+            case OP_SUB:
+            case OP_MUL:
+            case OP_DIV:
+            case OP_POW: {
+                static const char OPERATORS[] = {
+                    OPERATOR_PLUS, OPERATOR_MINUS, OPERATOR_MULTIPLY, OPERATOR_DIVIDE, OPERATOR_POWER
+                };
+                int left = stack[top - 1];
+                int right = stack[top];
+                top -= 2;
+                char* a = operand_text(&terms[left]);
+                char* b = operand_text(&terms[right]);
+                char format[8];
+                snprintf(format, sizeof(format), "%%s%c%%s", OPERATORS[instruction->code - OP_ADD]);
+                term->text = format_text(format, a, b);
+                free(a);
+                free(b);
+                add_operand(term, &term->left, terms, left);
+                add_operand(term, &term->right, terms, right);
+                break;
+            }
+            case OP_NEG: {
+                int operand = stack[top--];
+                char* a = operand_text(&terms[operand]);
+                term->text = format_text("-%s%s", a, "");
+                free(a);
+                add_operand(term, &term->left, terms, operand);
+                break;
+            }
+            case OP_RECIP: {
+                int operand = stack[top--];
+                term->text   = format_text("recip(%s)%s", terms[operand].text, "");
+                term->atomic = true;
+                add_operand(term, &term->left, terms, operand);
+                break;
+            }
+            case OP_FUNC: {
+                int operand = stack[top--];
+                const FunctionInfo* info = get_function_info(instruction->operand);
+                term->text   = format_text("%s(%s)", info != NULL ? info->name : "?", terms[operand].text);
+                term->atomic = true;
+                add_operand(term, &term->left, terms, operand);
+                break;
+            }
+            case OP_HORNER: {
+                int operand = stack[top--];
+                term->text = polynomial_text(&program->constants[instruction->operand], &terms[operand]);
+                add_operand(term, &term->left, terms, operand);
+                break;
+            }
+        }
+        stack[++top] = count++;
+    }
+
+    fprintf(file, "---------------------------------\n");
+    fprintf(file, "Evaluation profile: %llu points, %llu ticks", evaluated, all);
+    if (evaluated > 0) {
+        fprintf(file, ", %.1f per point", (double)all / evaluated);
+    }
+    fprintf(file, "\n");
+    if (all > 0) {
+        terms[stack[0]].listed = true;
+        fprintf(file, "%7s %7s  %s\n", "total", "self", "subterm");
+        print_subterm(file, terms, stack[0], 0, all);
+        print_operations(file, program, profile, all);
+    }
+    fprintf(file, "---------------------------------\n");
+
+    for (int i = 0; i < count; i++) {
+        free(terms[i].text);
+    }
+    free(terms);
+}
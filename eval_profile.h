@@ -0,0 +1,32 @@
+#ifndef EVAL_PROFILE_H
+#define EVAL_PROFILE_H
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "bytecode.h"
+
+// Subterms longer than this are shortened in the report
+#define EVAL_PROFILE_TEXT_WIDTH 60
+
+// Allocating zeroed counters for every instruction of the program
+bool init_program_profile(ProgramProfile* profile, const ExpressionProgram* program);
+
+// Releasing the counters
+void free_program_profile(ProgramProfile* profile);
+
+/**
+ * @brief Prints where the evaluation of a program spent its time.
+ *
+ * @param file Output stream
+ * @param program Program the profile was attached to
+ * @param profile Counters filled by the evaluators
+ *
+ * The program is read back into its subterms, each listed with its share of
+ * all ticks including its operands and its own share. Constants, x and
+ * reloaded shared results are not listed, their cost counts toward the
+ * subterm using them. A shared subterm is listed once, where it is computed,
+ * and marked with its slot. A table per operation and function follows.
+ */
+void print_program_profile(FILE* file, const ExpressionProgram* program, const ProgramProfile* profile);
+
+#endif // EVAL_PROFILE_H
@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include <string.h>
+#include "expression_cache.h"
+
+// FNV-1a hash of the key, compared before the strings
+static unsigned long hash_key(const char* key) {
+    unsigned long hash = 14695981039346656037UL;
+    for (const unsigned char* c = (const unsigned char*)key; *c != '\0'; c++) {
+        hash = (hash ^ *c) * 1099511628211UL;
+    }
+    return hash;
+}
+
+// Taking an entry out of the recency list
+static void unlink_entry(expression_cache_t* cache, cached_expression_t* entry) {
+    if (entry->newer != NULL) {
+        entry->newer->older = entry->older;
+    } else {
+        cache->newest = entry->older;
+    }
+    if (entry->older != NULL) {
+        entry->older->newer = entry->newer;
+    } else {
+        cache->oldest = entry->newer;
+    }
+    entry->newer = entry->older = NULL;
+}
+
+// Putting an entry in front of the recency list
+static void push_newest(expression_cache_t* cache, cached_expression_t* entry) {
+    entry->older = cache->newest;
+    entry->newer = NULL;
+    if (cache->newest != NULL) {
+        cache->newest->newer = entry;
+    } else {
+        cache->oldest = entry;
+    }
+    cache->newest = entry;
+}
+
+static void free_entry(cached_expression_t* entry) {
+    if (entry->has_jit) {
+        jit_free(&entry->jit);
+    }
+    free_program(&entry->program);
+    free(entry->key);
+    free(entry);
+}
+
+void init_expression_cache(expression_cache_t* cache, int capacity) {
+    memset(cache, 0, sizeof(expression_cache_t));
+    cache->capacity = capacity < 1 ? 1 : capacity;
+}
+
+void free_expression_cache(expression_cache_t* cache) {
+    cached_expression_t* entry = cache->newest;
+    while (entry != NULL) {
+        cached_expression_t* older = entry->older;
+        free_entry(entry);
+        entry = older;
+    }
+    cache->newest = cache->oldest = NULL;
+    cache->count = 0;
+}
+
+cached_expression_t* find_cached_expression(expression_cache_t* cache, const char* key) {
+    if (cache == NULL || key == NULL) {
+        return NULL;
+    }
+
+    // A few hundred entries at most, a linear scan over the hashes is enough
+    unsigned long hash = hash_key(key);
+    for (cached_expression_t* entry = cache->newest; entry != NULL; entry = entry->older) {
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            unlink_entry(cache, entry);
+            push_newest(cache, entry);
+            cache->hits++;
+            return entry;
+        }
+    }
+    cache->misses++;
+    return NULL;
+}
+
+cached_expression_t* insert_cached_expression(expression_cache_t* cache, const char* key,
+                                              const ExpressionProgram* program) {
+    if (cache == NULL || key == NULL || program == NULL) {
+        return NULL;
+    }
+
+    cached_expression_t* entry = (cached_expression_t*)calloc(1, sizeof(cached_expression_t));
+    if (entry == NULL || (entry->key = strdup(key)) == NULL) {
+        free(entry);
+        return NULL;
+    }
+    entry->hash = hash_key(key);
+    entry->program = *program;
+
+    if (cache->count == cache->capacity) {
+        cached_expression_t* oldest = cache->oldest;
+        unlink_entry(cache, oldest);
+        free_entry(oldest);
+        cache->count--;
+        cache->evictions++;
+    }
+    push_newest(cache, entry);
+    cache->count++;
+    return entry;
+}
@@ -0,0 +1,64 @@
+#ifndef EXPRESSION_CACHE_H
+#define EXPRESSION_CACHE_H
+
+#include <stdbool.h>
+#include "bytecode.h"
+#include "jit.h"
+
+// Default number of compiled expressions kept by the render daemon
+#define EXPRESSION_CACHE_ENTRIES 128
+// Upper bound for --cache, lookups scan the entries
+#define EXPRESSION_CACHE_MAX_ENTRIES 4096
+
+// Compiled expression, the native code is added when a request first asks for it
+typedef struct cached_expression {
+    char*                     key;        // normalized function string
+    unsigned long             hash;
+    ExpressionProgram         program;
+    JitProgram                jit;
+    bool                      has_jit;
+    bool                      jit_failed; // not retried for this entry
+    struct cached_expression* newer;      // towards the most recently used entry
+    struct cached_expression* older;
+} cached_expression_t;
+
+// Least recently used cache of compiled expressions, keyed by the string from remove_spaces()
+typedef struct {
+    cached_expression_t* newest;
+    cached_expression_t* oldest;
+    int       count;
+    int       capacity;
+    long long hits;
+    long long misses;
+    long long evictions;
+} expression_cache_t;
+
+// Initializing an empty cache holding at most `capacity` expressions
+void init_expression_cache(expression_cache_t* cache, int capacity);
+
+// Releasing every entry
+void free_expression_cache(expression_cache_t* cache);
+
+/**
+ * @brief Looks up a compiled expression and marks it as most recently used.
+ *
+ * @param cache Cache to search
+ * @param key Normalized function string
+ * @return cached_expression_t* The entry, NULL on a miss.
+ *
+ * The entry stays valid until the next insertion.
+ */
+cached_expression_t* find_cached_expression(expression_cache_t* cache, const char* key);
+
+/**
+ * @brief Adds a compiled expression, evicting the least recently used one when full.
+ *
+ * @param cache Cache to add to
+ * @param key Normalized function string, copied
+ * @param program Compiled program, owned by the cache afterwards
+ * @return cached_expression_t* The new entry, NULL on allocation failure (the program is then not taken).
+ */
+cached_expression_t* insert_cached_expression(expression_cache_t* cache, const char* key,
+                                              const ExpressionProgram* program);
+
+#endif // EXPRESSION_CACHE_H
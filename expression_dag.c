@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "expression_dag.h"
+
+// Counting the nodes of a tree to size the DAG once
+static size_t count_tree_nodes(const ExprNode* node) {
+    if (node == NULL) {
+        return 0;
+    }
+    return 1 + count_tree_nodes(node->left) + count_tree_nodes(node->right);
+}
+
+// Hashing the identity of a node (FNV-1a over its fields)
+static uint64_t hash_node(const DagNode* node) {
+    uint64_t bits = 0;
+    memcpy(&bits, &node->value, sizeof(bits));
+
+    uint64_t fields[6] = {
+        (uint64_t)node->kind, bits, (uint64_t)(unsigned char)node->op,
+        (uint64_t)node->func_id, (uint64_t)(int64_t)node->left, (uint64_t)(int64_t)node->right
+    };
+
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        hash ^= fields[i];
+        hash *= 1099511628211ULL;
+    }
+    for (int i = 0; node->coefficients != NULL && i <= node->degree; i++) {
+        memcpy(&bits, &node->coefficients[i], sizeof(bits));
+        hash ^= bits;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Checking if two nodes describe the same subexpression
+static bool same_node(const DagNode* a, const DagNode* b) {
+    if (a->kind != b->kind || a->op != b->op || a->func_id != b->func_id ||
+        a->left != b->left || a->right != b->right || a->degree != b->degree ||
+        memcmp(&a->value, &b->value, sizeof(double)) != 0) {
+        return false;
+    }
+    return a->coefficients == NULL ||
+           memcmp(a->coefficients, b->coefficients, (a->degree + 1) * sizeof(double)) == 0;
+}
+
+// Returning the index of an existing equal node or appending a new one
+static int intern_node(ExpressionDag* dag, const DagNode* candidate) {
+    size_t mask = dag->table_size - 1;
+    size_t slot = (size_t)hash_node(candidate) & mask;
+
+    while (dag->table[slot] >= 0) {
+        if (same_node(&dag->nodes[dag->table[slot]], candidate)) {
+            return dag->table[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    int index = (int)dag->count++;
+    dag->nodes[index] = *candidate;
+    dag->nodes[index].uses = 0;
+    dag->table[slot] = index;
+
+    if (candidate->left >= 0) {
+        dag->nodes[candidate->left].uses++;
+    }
+    if (candidate->right >= 0) {
+        dag->nodes[candidate->right].uses++;
+    }
+    return index;
+}
+
+// Interning a tree bottom-up, returning the index of its root
+static int intern_tree(ExpressionDag* dag, const ExprNode* node) {
+    DagNode candidate = {node->kind, 0.0, 0, 0, NULL, 0, -1, -1, 0};
+
+    switch (node->kind) {
+        case NODE_CONST:
+            candidate.value = node->value;
+            break;
+        case NODE_VARIABLE:
+            break;
+        case NODE_NEGATE:
+        case NODE_RECIPROCAL:
+            candidate.left = intern_tree(dag, node->left);
+            break;
+        case NODE_BINARY:
+            candidate.op    = node->op;
+            candidate.left  = intern_tree(dag, node->left);
+            candidate.right = intern_tree(dag, node->right);
+            break;
+        case NODE_FUNCTION:
+            candidate.func_id = node->func_id;
+            candidate.left    = intern_tree(dag, node->left);
+            break;
+        case NODE_POLYNOMIAL:
+            candidate.coefficients = node->coefficients;
+            candidate.degree       = node->degree;
+            candidate.left         = intern_tree(dag, node->left);
+            break;
+    }
+
+    return intern_node(dag, &candidate);
+}
+
+bool build_expression_dag(const ExprNode* tree, ExpressionDag* dag) {
+    if (tree == NULL || dag == NULL) {
+        return false;
+    }
+
+    memset(dag, 0, sizeof(ExpressionDag));
+    dag->capacity = count_tree_nodes(tree);
+
+    // Power of two, at most half full
+    dag->table_size = 1;
+    while (dag->table_size < 2 * dag->capacity) {
+        dag->table_size <<= 1;
+    }
+
+    dag->nodes = (DagNode*)malloc(dag->capacity * sizeof(DagNode));
+    dag->table = (int*)malloc(dag->table_size * sizeof(int));
+    if (dag->nodes == NULL || dag->table == NULL) {
+        free_expression_dag(dag);
+        return false;
+    }
+    for (size_t i = 0; i < dag->table_size; i++) {
+        dag->table[i] = -1;
+    }
+
+    dag->root = intern_tree(dag, tree);
+    return true;
+}
+
+void free_expression_dag(ExpressionDag* dag) {
+    if (dag == NULL) {
+        return;
+    }
+
+    free(dag->nodes);
+    free(dag->table);
+    memset(dag, 0, sizeof(ExpressionDag));
+}
@@ -0,0 +1,48 @@
+#ifndef EXPRESSION_DAG_H
+#define EXPRESSION_DAG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "expression_tree.h"
+
+// Node of a hash-consed expression DAG, children are node indices
+typedef struct {
+    NodeKind kind;
+    double value;  // for constants
+    char op;       // for binary operators
+    int func_id;   // for functions
+    const double* coefficients; // for polynomials, owned by the tree
+    int degree;    // for polynomials
+    int left;      // -1 if absent
+    int right;     // -1 if absent
+    int uses;      // number of references from parent nodes
+} DagNode;
+
+// Expression DAG in which every distinct subexpression exists once
+typedef struct {
+    DagNode* nodes;     // children always precede their parents
+    size_t   count;     // number of nodes
+    size_t   capacity;  // allocated nodes
+    int*     table;     // open addressing hash table of node indices, -1 if empty
+    size_t   table_size;
+    int      root;      // index of the root node
+} ExpressionDag;
+
+/**
+ * @brief Builds a hash-consed DAG from an expression tree.
+ *
+ * @param tree Root of the expression tree
+ * @param dag DAG to fill
+ * @return true if successful, false on allocation failure.
+ *
+ * Structurally identical subtrees map to the same node. Constants are
+ * compared bit by bit, so NaN matches NaN and -0 does not match 0.
+ * Polynomial nodes point to the coefficients of the tree, which must
+ * outlive the DAG.
+ */
+bool build_expression_dag(const ExprNode* tree, ExpressionDag* dag);
+
+// Releasing memory owned by a DAG
+void free_expression_dag(ExpressionDag* dag);
+
+#endif // EXPRESSION_DAG_H
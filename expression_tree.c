@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "expression_tree.h"
+#include "function_registry.h"
+#include "defs.h"
+
+// Allocating a zeroed node of the given kind
+static ExprNode* make_node(NodeKind kind) {
+    ExprNode* node = (ExprNode*)calloc(1, sizeof(ExprNode));
+    if (node != NULL) {
+        node->kind = kind;
+    }
+    return node;
+}
+
+ExprNode* make_const_node(double value) {
+    ExprNode* node = make_node(NODE_CONST);
+    if (node != NULL) {
+        node->value = value;
+    }
+    return node;
+}
+
+ExprNode* make_variable_node(void) {
+    return make_node(NODE_VARIABLE);
+}
+
+ExprNode* make_negate_node(ExprNode* operand) {
+    if (operand == NULL) {
+        return NULL;
+    }
+
+    ExprNode* node = make_node(NODE_NEGATE);
+    if (node == NULL) {
+        free_expression_tree(operand);
+        return NULL;
+    }
+    node->left = operand;
+    return node;
+}
+
+ExprNode* make_reciprocal_node(ExprNode* operand) {
+    if (operand == NULL) {
+        return NULL;
+    }
+
+    ExprNode* node = make_node(NODE_RECIPROCAL);
+    if (node == NULL) {
+        free_expression_tree(operand);
+        return NULL;
+    }
+    node->left = operand;
+    return node;
+}
+
+ExprNode* make_binary_node(char op, ExprNode* left, ExprNode* right) {
+    if (left == NULL || right == NULL) {
+        free_expression_tree(left);
+        free_expression_tree(right);
+        return NULL;
+    }
+
+    ExprNode* node = make_node(NODE_BINARY);
+    if (node == NULL) {
+        free_expression_tree(left);
+        free_expression_tree(right);
+        return NULL;
+    }
+    node->op    = op;
+    node->left  = left;
+    node->right = right;
+    return node;
+}
+
+ExprNode* make_function_node(int func_id, ExprNode* argument) {
+    if (argument == NULL) {
+        return NULL;
+    }
+
+    ExprNode* node = make_node(NODE_FUNCTION);
+    if (node == NULL) {
+        free_expression_tree(argument);
+        return NULL;
+    }
+    node->func_id = func_id;
+    node->left    = argument;
+    return node;
+}
+
+ExprNode* make_polynomial_node(const double* coefficients, int degree, ExprNode* argument) {
+    if (argument == NULL) {
+        return NULL;
+    }
+
+    ExprNode* node = make_node(NODE_POLYNOMIAL);
+    if (node != NULL) {
+        node->coefficients = (double*)malloc((degree + 1) * sizeof(double));
+    }
+    if (node == NULL || node->coefficients == NULL) {
+        free(node);
+        free_expression_tree(argument);
+        return NULL;
+    }
+    memcpy(node->coefficients, coefficients, (degree + 1) * sizeof(double));
+    node->degree = degree;
+    node->left   = argument;
+    return node;
+}
+
+ExprNode* clone_expression_tree(const ExprNode* root) {
+    if (root == NULL) {
+        return NULL;
+    }
+
+    switch (root->kind) {
+        case NODE_CONST:
+            return make_const_node(root->value);
+        case NODE_VARIABLE:
+            return make_variable_node();
+        case NODE_NEGATE:
+            return make_negate_node(clone_expression_tree(root->left));
+        case NODE_BINARY:
+            return make_binary_node(root->op, clone_expression_tree(root->left),
+                                    clone_expression_tree(root->right));
+        case NODE_FUNCTION:
+            return make_function_node(root->func_id, clone_expression_tree(root->left));
+        case NODE_POLYNOMIAL:
+            return make_polynomial_node(root->coefficients, root->degree,
+                                        clone_expression_tree(root->left));
+        case NODE_RECIPROCAL:
+            return make_reciprocal_node(clone_expression_tree(root->left));
+    }
+    return NULL;
+}
+
+ExprNode* build_expression_tree(const TokenQueue* queue) {
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    size_t count = 0;
+    for (const TokenNode* node = queue->front; node != NULL; node = node->next) {
+        count++;
+    }
+    if (count == 0) {
+        return NULL;
+    }
+
+    // Operand stack, never deeper than the number of tokens
+    ExprNode** stack = (ExprNode**)malloc(count * sizeof(ExprNode*));
+    if (stack == NULL) {
+        return NULL;
+    }
+    size_t top = 0;
+    bool ok = true;
+
+    for (const TokenNode* node = queue->front; node != NULL && ok; node = node->next) {
+        const Token* token = &node->token;
+        ExprNode* result = NULL;
+
+        if (token->type == TOKEN_NUMBER) {
+            result = make_const_node(token->value);
+        } else if (token->type == TOKEN_VARIABLE) {
+            result = make_variable_node();
+        } else if (token->type == TOKEN_OPERATOR && token->op == OPERATOR_UNARY_MINUS) {
+            if (top < 1) {
+                ok = false;
+                break;
+            }
+            result = make_negate_node(stack[--top]);
+        } else if (token->type == TOKEN_OPERATOR) {
+            if (top < 2) {
+                ok = false;
+                break;
+            }
+            ExprNode* right = stack[--top];
+            ExprNode* left  = stack[--top];
+            result = make_binary_node(token->op, left, right);
+        } else if (token->type == TOKEN_FUNCTION && get_function_info(token->func_id) != NULL) {
+            if (top < 1) {
+                ok = false;
+                break;
+            }
+            result = make_function_node(token->func_id, stack[--top]);
+        } else {
+            ok = false;
+            break;
+        }
+
+        if (result == NULL) {
+            ok = false;
+            break;
+        }
+        stack[top++] = result;
+    }
+
+    // A well-formed queue leaves exactly one node
+    ExprNode* root = NULL;
+    if (ok && top == 1) {
+        root = stack[0];
+        top = 0;
+    }
+    while (top > 0) {
+        free_expression_tree(stack[--top]);
+    }
+    free(stack);
+    return root;
+}
+
+void print_expression_tree(FILE* file, const ExprNode* root) {
+    if (file == NULL || root == NULL) {
+        return;
+    }
+
+    switch (root->kind) {
+        case NODE_CONST:
+            fprintf(file, "%g", root->value);
+            break;
+        case NODE_VARIABLE:
+            fprintf(file, "%c", VALID_VARIABLE);
+            break;
+        case NODE_NEGATE:
+            fprintf(file, "-(");
+            print_expression_tree(file, root->left);
+            fprintf(file, ")");
+            break;
+        case NODE_BINARY:
+            fprintf(file, "(");
+            print_expression_tree(file, root->left);
+            fprintf(file, " %c ", root->op);
+            print_expression_tree(file, root->right);
+            fprintf(file, ")");
+            break;
+        case NODE_FUNCTION:
+            fprintf(file, "%s(", get_function_info(root->func_id)->name);
+            print_expression_tree(file, root->left);
+            fprintf(file, ")");
+            break;
+        case NODE_POLYNOMIAL:
+            fprintf(file, "horner[");
+            for (int i = 0; i <= root->degree; i++) {
+                fprintf(file, i == 0 ? "%g" : ", %g", root->coefficients[i]);
+            }
+            fprintf(file, "](");
+            print_expression_tree(file, root->left);
+            fprintf(file, ")");
+            break;
+        case NODE_RECIPROCAL:
+            fprintf(file, "recip(");
+            print_expression_tree(file, root->left);
+            fprintf(file, ")");
+            break;
+    }
+}
+
+void free_expression_tree(ExprNode* root) {
+    if (root == NULL) {
+        return;
+    }
+
+    free_expression_tree(root->left);
+    free_expression_tree(root->right);
+    free(root->coefficients);
+    free(root);
+}
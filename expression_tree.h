@@ -0,0 +1,60 @@
+#ifndef EXPRESSION_TREE_H
+#define EXPRESSION_TREE_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "shuntingyard.h"
+
+// Kinds of expression tree nodes
+typedef enum {
+    NODE_CONST,    // number
+    NODE_VARIABLE, // x
+    NODE_NEGATE,   // unary minus, operand in left
+    NODE_BINARY,   // binary operator, operands in left and right
+    NODE_FUNCTION, // registry function, argument in left
+    NODE_POLYNOMIAL, // polynomial in left evaluated in Horner form
+    NODE_RECIPROCAL  // 1 / left with IEEE division, +-inf at +-0 like pow(a, -1)
+} NodeKind;
+
+// Highest degree of a NODE_POLYNOMIAL
+#define POLYNOMIAL_MAX_DEGREE 16
+
+// Node of an expression tree
+typedef struct ExprNode {
+    NodeKind kind;
+    double value;  // for constants
+    char op;       // for binary operators
+    int func_id;   // for functions
+    double* coefficients; // for polynomials, highest degree first
+    int degree;           // for polynomials, degree + 1 coefficients
+    struct ExprNode* left;
+    struct ExprNode* right;
+} ExprNode;
+
+// Creating nodes, NULL on allocation failure
+ExprNode* make_const_node(double value);
+ExprNode* make_variable_node(void);
+ExprNode* make_negate_node(ExprNode* operand);
+ExprNode* make_binary_node(char op, ExprNode* left, ExprNode* right);
+ExprNode* make_function_node(int func_id, ExprNode* argument);
+ExprNode* make_polynomial_node(const double* coefficients, int degree, ExprNode* argument);
+ExprNode* make_reciprocal_node(ExprNode* operand);
+
+// Deep copy of a tree, NULL on allocation failure
+ExprNode* clone_expression_tree(const ExprNode* root);
+
+/**
+ * @brief Builds an expression tree from an RPN token queue.
+ *
+ * @param queue Token queue produced by parse_expression()
+ * @return ExprNode* Root of the tree, or NULL if the queue is malformed.
+ */
+ExprNode* build_expression_tree(const TokenQueue* queue);
+
+// Printing a tree as a fully parenthesized infix expression
+void print_expression_tree(FILE* file, const ExprNode* root);
+
+// Releasing a tree and all its children
+void free_expression_tree(ExprNode* root);
+
+#endif // EXPRESSION_TREE_H
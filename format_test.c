@@ -0,0 +1,66 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "defs.h"
+#include "postscriptexport.h"
+
+// Random numbers checked against printf, on top of the decimal and binary midpoints
+#define FORMAT_TEST_RANDOM_VALUES 1600000
+
+// Mismatches printed before the rest are only counted
+#define FORMAT_TEST_REPORTED 5
+
+// Values at the ends of the fast path and the widest outputs, including the ones that fill FIXED2_MAX_LENGTH
+static const double FORMAT_TEST_SPECIAL_VALUES[] = {
+    0.0, -0.0, 0.005, -0.005, 0.015, 0.125, 0.375, -0.125, 1e-300, -1e-300, 4.9e-324,
+    1e13, -1e13, 9007199254740991.0, 9007199254740993.0, 1e18, 1e22, 1e28, -1e28, 1e100, 1e300,
+    DBL_MAX, -DBL_MAX, INFINITY, -INFINITY, NAN
+};
+static const size_t NUM_FORMAT_TEST_SPECIAL_VALUES =
+    sizeof(FORMAT_TEST_SPECIAL_VALUES) / sizeof(FORMAT_TEST_SPECIAL_VALUES[0]);
+
+// Checking format_fixed2() at one value against printf, reporting the first mismatches
+static bool check_value(double value, size_t* mismatches) {
+    char expected[FIXED2_MAX_LENGTH];
+    char actual[FIXED2_MAX_LENGTH];
+
+    int expected_length = snprintf(expected, sizeof(expected), "%.2f", value);
+    int length = format_fixed2(value, actual);
+    bool passed = expected_length >= 0 && expected_length < FIXED2_MAX_LENGTH && length == expected_length;
+    if (passed) {
+        actual[length] = END_STRING_CHAR;
+        passed = strcmp(expected, actual) == 0;
+    }
+    if (!passed) {
+        if (*mismatches < FORMAT_TEST_REPORTED) {
+            printf("FAIL %.17g: printf '%s' (%d chars), format_fixed2 %d chars\n", value, expected, expected_length,
+                   length);
+        }
+        (*mismatches)++;
+    }
+    return passed;
+}
+
+int main(void) {
+    size_t mismatches = 0;
+    size_t checked = 0;
+
+    for (size_t i = 0; i < NUM_FORMAT_TEST_SPECIAL_VALUES; i++, checked++) {
+        check_value(FORMAT_TEST_SPECIAL_VALUES[i], &mismatches);
+    }
+    for (int i = 0; i < 200000; i++, checked++) {
+        check_value((i - 100000) / 100.0 + 0.005, &mismatches);    // decimal midpoints, mostly inexact
+    }
+    for (int i = 0; i < 200000; i++, checked++) {
+        check_value((i - 100000) / 8.0, &mismatches);              // exact binary midpoints, ties to even
+    }
+    srand(1);
+    for (int i = 0; i < FORMAT_TEST_RANDOM_VALUES; i++, checked++) {
+        check_value(((double)rand() / RAND_MAX - 0.5) * pow(10, rand() % 16 - 3), &mismatches);
+    }
+
+    printf("%zu of %zu values match printf\n", checked - mismatches, checked);
+    return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -6,17 +6,10 @@
 #include "function_normalizer.h"
 #include "defs.h"
 #include "parser_utils.h"
+#include "function_registry.h"
 
 const char VALID_OPERATORS[] = VALID_DEFINED_OPERATORS;
 
-// Valid functions are ordered by length (descending) to prevent functions from the conflict
-// For example: sin(x) and sinh(x)
-const char* VALID_FUNCTIONS[] = {
-    FUNC_ASIN, FUNC_ACOS, FUNC_ATAN, FUNC_SINH, FUNC_COSH, FUNC_TANH,
-    FUNC_ABS, FUNC_EXP, FUNC_LOG, FUNC_SIN, FUNC_COS, FUNC_TAN, FUNC_LN
-};
-const size_t NUM_VALID_FUNCTIONS = sizeof(VALID_FUNCTIONS) / sizeof(VALID_FUNCTIONS[0]);
-
 
 char* remove_spaces(const char* function) {
     if (function == NULL) {
@@ -124,16 +117,14 @@ bool check_valid_functions(const char* expression, size_t *index) {
         return false;
     }
 
-    for (size_t j = 0; j < NUM_VALID_FUNCTIONS; j++) {
-        size_t func_len = strlen(VALID_FUNCTIONS[j]);
-        // Valid functions are ordered by length (descending) to prevent functions from the conflict
-        // For example: sin(x) and sinh(x)
-        if (strncmp(&expression[*index], VALID_FUNCTIONS[j], func_len) == 0) {
-            *index += func_len;
-            return true;
-        }
+    // The longest registered name wins to prevent functions from the conflict
+    // For example: sin(x) and sinh(x)
+    size_t func_len = match_function_prefix(&expression[*index]);
+    if (func_len == 0) {
+        return false;
     }
-    return false;
+    *index += func_len;
+    return true;
 }
 
 // Helper Function to Convert Scientific Notation to Standard Decimal
@@ -277,7 +268,7 @@ bool check_number(char* expression, size_t* index) {
             *index = original_index;
             return false;
         }
-        printf("[DEBUG]: Converted scientific notation to standard decimal: %s\n", converted_number);
+        DEBUG_PRINTF("[DEBUG]: Converted scientific notation to standard decimal: %s\n", converted_number);
     } else {
         // No conversion needed; ensure that there are digits
         if (!has_digits) {
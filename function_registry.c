@@ -0,0 +1,260 @@
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include "function_registry.h"
+#include "defs.h"
+
+// Domain checks, written so that NaN arguments pass through to the kernel
+static bool positive_domain(double arg) {
+    return !(arg <= 0);
+}
+
+static bool unit_domain(double arg) {
+    return !(arg < -1 || arg > 1);
+}
+
+static bool non_negative_domain(double arg) {
+    return !(arg < 0);
+}
+
+// Batch kernel over an array of arguments, `arg` is the current element
+#define BATCH_KERNEL(kernel_name, expression)               \
+    static void kernel_name(double* values, size_t n) {     \
+        for (size_t i = 0; i < n; i++) {                    \
+            double arg = values[i];                         \
+            values[i] = (expression);                       \
+        }                                                   \
+    }
+
+BATCH_KERNEL(abs_batch,  fabs(arg))
+BATCH_KERNEL(exp_batch,  exp(arg))
+BATCH_KERNEL(ln_batch,   arg <= 0 ? NAN : log(arg))
+BATCH_KERNEL(log_batch,  arg <= 0 ? NAN : log10(arg))
+BATCH_KERNEL(sin_batch,  sin(arg))
+BATCH_KERNEL(cos_batch,  cos(arg))
+BATCH_KERNEL(tan_batch,  tan(arg))
+BATCH_KERNEL(asin_batch, (arg < -1 || arg > 1) ? NAN : asin(arg))
+BATCH_KERNEL(acos_batch, (arg < -1 || arg > 1) ? NAN : acos(arg))
+BATCH_KERNEL(atan_batch, atan(arg))
+BATCH_KERNEL(sinh_batch, sinh(arg))
+BATCH_KERNEL(cosh_batch, cosh(arg))
+BATCH_KERNEL(tanh_batch, tanh(arg))
+BATCH_KERNEL(sqrt_batch, arg < 0 ? NAN : sqrt(arg))
+
+// Interval kernels, arguments are cut down to the domain first
+static Interval abs_interval(Interval a) {
+    if (interval_is_empty(a) || a.lo >= 0) {
+        return a;
+    }
+    if (a.hi <= 0) {
+        return interval_neg(a);
+    }
+    return make_interval(0, fmax(-a.lo, a.hi));
+}
+
+static Interval exp_interval(Interval a)  { return interval_increasing(exp, a); }
+static Interval atan_interval(Interval a) { return interval_increasing(atan, a); }
+static Interval sinh_interval(Interval a) { return interval_increasing(sinh, a); }
+static Interval tanh_interval(Interval a) { return interval_increasing(tanh, a); }
+static Interval ln_interval(Interval a)   { return interval_increasing(log, interval_clip(a, 0, INFINITY)); }
+static Interval log_interval(Interval a)  { return interval_increasing(log10, interval_clip(a, 0, INFINITY)); }
+static Interval sqrt_interval(Interval a) { return interval_increasing(sqrt, interval_clip(a, 0, INFINITY)); }
+static Interval asin_interval(Interval a) { return interval_increasing(asin, interval_clip(a, -1, 1)); }
+static Interval acos_interval(Interval a) { return interval_decreasing(acos, interval_clip(a, -1, 1)); }
+
+static Interval cosh_interval(Interval a) {
+    if (interval_is_empty(a) || a.lo >= 0) {
+        return interval_increasing(cosh, a);
+    }
+    if (a.hi <= 0) {
+        return interval_decreasing(cosh, a);
+    }
+    return interval_widen(make_interval(1, fmax(cosh(a.lo), cosh(a.hi))), 4);
+}
+
+// Largest argument for which the periodic kernels locate their extremes
+#define PERIODIC_MAX_ARGUMENT 1e6
+
+// Checking if phase + k*period lies in [lo, hi] for some integer k, with a safety margin
+static bool contains_periodic_point(Interval a, double phase, double period) {
+    double margin = 1e-9 * (1 + fmax(fabs(a.lo), fabs(a.hi)));
+    double k = ceil((a.lo - margin - phase) / period);
+    return phase + k * period <= a.hi + margin;
+}
+
+// sin or cos: the bounds, or +-1 where a maximum or minimum lies inside
+static Interval periodic_interval(double (*function)(double), Interval a, double maximum_phase) {
+    if (interval_is_empty(a)) {
+        return a;
+    }
+    if (!(fabs(a.lo) < PERIODIC_MAX_ARGUMENT && fabs(a.hi) < PERIODIC_MAX_ARGUMENT) || a.hi - a.lo >= 2 * M_PI) {
+        return make_interval(-1, 1);
+    }
+
+    double lo = fmin(function(a.lo), function(a.hi));
+    double hi = fmax(function(a.lo), function(a.hi));
+    if (contains_periodic_point(a, maximum_phase, 2 * M_PI)) {
+        hi = 1;
+    }
+    if (contains_periodic_point(a, maximum_phase + M_PI, 2 * M_PI)) {
+        lo = -1;
+    }
+    return interval_widen(make_interval(lo, hi), 4);
+}
+
+static Interval sin_interval(Interval a) { return periodic_interval(sin, a, M_PI / 2); }
+static Interval cos_interval(Interval a) { return periodic_interval(cos, a, 0); }
+
+static Interval tan_interval(Interval a) {
+    if (interval_is_empty(a)) {
+        return a;
+    }
+    if (!(fabs(a.lo) < PERIODIC_MAX_ARGUMENT && fabs(a.hi) < PERIODIC_MAX_ARGUMENT) || a.hi - a.lo >= M_PI ||
+        contains_periodic_point(a, M_PI / 2, M_PI)) {
+        return entire_interval();  // a pole inside
+    }
+    return interval_increasing(tan, a);
+}
+
+// Number of built-in entries at the start of the registry
+#define NUM_BUILTIN_FUNCTIONS 14
+
+// Registry, starting with the built-in functions
+static FunctionInfo registry[MAX_REGISTERED_FUNCTIONS] = {
+    {FUNC_ABS,  1, NULL,                fabs,  abs_batch,   abs_interval},
+    {FUNC_EXP,  1, NULL,                exp,   exp_batch,   exp_interval},
+    {FUNC_LN,   1, positive_domain,     log,   ln_batch,    ln_interval},
+    {FUNC_LOG,  1, positive_domain,     log10, log_batch,   log_interval},
+    {FUNC_SIN,  1, NULL,                sin,   sin_batch,   sin_interval},
+    {FUNC_COS,  1, NULL,                cos,   cos_batch,   cos_interval},
+    {FUNC_TAN,  1, NULL,                tan,   tan_batch,   tan_interval},
+    {FUNC_ASIN, 1, unit_domain,         asin,  asin_batch,  asin_interval},
+    {FUNC_ACOS, 1, unit_domain,         acos,  acos_batch,  acos_interval},
+    {FUNC_ATAN, 1, NULL,                atan,  atan_batch,  atan_interval},
+    {FUNC_SINH, 1, NULL,                sinh,  sinh_batch,  sinh_interval},
+    {FUNC_COSH, 1, NULL,                cosh,  cosh_batch,  cosh_interval},
+    {FUNC_TANH, 1, NULL,                tanh,  tanh_batch,  tanh_interval},
+    {FUNC_SQRT, 1, non_negative_domain, sqrt,  sqrt_batch,  sqrt_interval}
+};
+static size_t registry_count = NUM_BUILTIN_FUNCTIONS;
+
+bool register_function(const char* name, int arity, DomainCheck in_domain, ScalarKernel scalar, BatchKernel batch,
+                       IntervalKernel interval) {
+    if (name == NULL || scalar == NULL) {
+        return false;
+    }
+
+    size_t length = strlen(name);
+    if (length == 0 || length >= MAX_REGISTERED_NAME_LENGTH) {
+        fprintf(stderr, "Error: Invalid function name '%s'.\n", name);
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        // The tokenizer reads function names as runs of letters
+        if (!islower((unsigned char)name[i])) {
+            fprintf(stderr, "Error: Invalid function name '%s'.\n", name);
+            return false;
+        }
+    }
+    if (arity != 1) {
+        fprintf(stderr, "Error: Function '%s' must take exactly one argument.\n", name);
+        return false;
+    }
+    if (find_function(name) >= 0) {
+        fprintf(stderr, "Error: Function '%s' is already registered.\n", name);
+        return false;
+    }
+    if (registry_count >= MAX_REGISTERED_FUNCTIONS) {
+        fprintf(stderr, "Error: Function registry is full.\n");
+        return false;
+    }
+
+    FunctionInfo* info = &registry[registry_count++];
+    strcpy(info->name, name);
+    info->arity     = arity;
+    info->in_domain = in_domain;
+    info->scalar    = scalar;
+    info->batch     = batch;
+    info->interval  = interval;
+    return true;
+}
+
+int find_function(const char* name) {
+    if (name == NULL) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < registry_count; i++) {
+        if (strcmp(name, registry[i].name) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+size_t match_function_prefix(const char* expression) {
+    if (expression == NULL) {
+        return 0;
+    }
+
+    size_t best = 0;
+    for (size_t i = 0; i < registry_count; i++) {
+        size_t length = strlen(registry[i].name);
+        if (length > best && strncmp(expression, registry[i].name, length) == 0) {
+            best = length;
+        }
+    }
+    return best;
+}
+
+const FunctionInfo* get_function_info(int id) {
+    if (id < 0 || (size_t)id >= registry_count) {
+        return NULL;
+    }
+    return &registry[id];
+}
+
+size_t registered_function_count(void) {
+    return registry_count;
+}
+
+double apply_function(int id, double arg) {
+    if (id < 0 || (size_t)id >= registry_count) {
+        return NAN;
+    }
+
+    const FunctionInfo* info = &registry[id];
+    if (info->in_domain != NULL && !info->in_domain(arg)) {
+        return NAN;
+    }
+    return info->scalar(arg);
+}
+
+void apply_function_batch(int id, double* values, size_t n) {
+    if (values == NULL) {
+        return;
+    }
+    if (id < 0 || (size_t)id >= registry_count) {
+        for (size_t i = 0; i < n; i++) {
+            values[i] = NAN;
+        }
+        return;
+    }
+
+    const FunctionInfo* info = &registry[id];
+    if (info->batch != NULL) {
+        info->batch(values, n);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        values[i] = apply_function(id, values[i]);
+    }
+}
+
+Interval apply_function_interval(int id, Interval arg) {
+    if (id < 0 || (size_t)id >= registry_count || registry[id].interval == NULL) {
+        return entire_interval();
+    }
+    return registry[id].interval(arg);
+}
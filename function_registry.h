@@ -0,0 +1,80 @@
+#ifndef FUNCTION_REGISTRY_H
+#define FUNCTION_REGISTRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "interval.h"
+
+// Maximum number of functions, built-in and registered at startup
+#define MAX_REGISTERED_FUNCTIONS 32
+
+// Maximum length of a function name including the terminator
+#define MAX_REGISTERED_NAME_LENGTH 8
+
+// Kernel computing a function for one argument
+typedef double (*ScalarKernel)(double arg);
+
+// Kernel computing a function in place for an array of arguments
+typedef void (*BatchKernel)(double* values, size_t n);
+
+// Domain check, returns false if the function is undefined for the argument
+typedef bool (*DomainCheck)(double arg);
+
+// Kernel enclosing the values of a function over an interval of arguments
+typedef Interval (*IntervalKernel)(Interval arg);
+
+// Registry entry describing one supported function
+typedef struct {
+    char         name[MAX_REGISTERED_NAME_LENGTH];
+    int          arity;     // number of arguments, the parser supports 1
+    DomainCheck  in_domain; // NULL if defined everywhere
+    ScalarKernel scalar;    // evaluation of one argument
+    BatchKernel  batch;     // NULL to fall back to in_domain + scalar
+    IntervalKernel interval; // NULL if unknown, any value is then assumed
+} FunctionInfo;
+
+/**
+ * @brief Registers an additional function.
+ *
+ * @param name Function name, lowercase letters only
+ * @param arity Number of arguments, must be 1
+ * @param in_domain Domain check or NULL
+ * @param scalar Scalar kernel
+ * @param batch Batch kernel or NULL
+ * @param interval Interval kernel or NULL, must enclose every defined result
+ * @return true if successful, false if the name is invalid, taken or the registry is full.
+ *
+ * Meant to be called at startup, before any expression is parsed.
+ */
+bool register_function(const char* name, int arity, DomainCheck in_domain, ScalarKernel scalar, BatchKernel batch,
+                       IntervalKernel interval);
+
+// Resolving a function name to its id, -1 if not registered
+int find_function(const char* name);
+
+/**
+ * @brief Matches the longest registered function name at the start of a string.
+ *
+ * @param expression String to look at
+ * @return size_t Length of the matched name, 0 if nothing matches.
+ *
+ * The longest match wins, so "sinh" is not read as "sin" followed by "h".
+ */
+size_t match_function_prefix(const char* expression);
+
+// Getting the registry entry for an id, NULL if the id is invalid
+const FunctionInfo* get_function_info(int id);
+
+// Number of registered functions
+size_t registered_function_count(void);
+
+// Applying a function to one argument, NaN outside its domain
+double apply_function(int id, double arg);
+
+// Applying a function in place to n arguments, NaN outside its domain
+void apply_function_batch(int id, double* values, size_t n);
+
+// Enclosing the defined values of a function over an interval of arguments
+Interval apply_function_interval(int id, Interval arg);
+
+#endif // FUNCTION_REGISTRY_H
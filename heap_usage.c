@@ -0,0 +1,80 @@
+#include <string.h>
+#include <stdatomic.h>
+#include <malloc.h>
+#include "heap_usage.h"
+
+static atomic_llong allocation_calls;
+static atomic_llong bytes_in_use;
+static atomic_llong peak_bytes;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* pointer, size_t size);
+void  __real_free(void* pointer);
+
+// Adding a block, or a negative size for one given back, and raising the peak
+static void count_bytes(long long bytes) {
+    long long now = atomic_fetch_add_explicit(&bytes_in_use, bytes, memory_order_relaxed) + bytes;
+    long long peak = atomic_load_explicit(&peak_bytes, memory_order_relaxed);
+    while (now > peak &&
+           !atomic_compare_exchange_weak_explicit(&peak_bytes, &peak, now, memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+void* __wrap_malloc(size_t size) {
+    atomic_fetch_add_explicit(&allocation_calls, 1, memory_order_relaxed);
+    void* pointer = __real_malloc(size);
+    count_bytes((long long)malloc_usable_size(pointer));
+    return pointer;
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    atomic_fetch_add_explicit(&allocation_calls, 1, memory_order_relaxed);
+    void* pointer = __real_calloc(count, size);
+    count_bytes((long long)malloc_usable_size(pointer));
+    return pointer;
+}
+
+void* __wrap_realloc(void* pointer, size_t size) {
+    atomic_fetch_add_explicit(&allocation_calls, 1, memory_order_relaxed);
+    long long old_size = (long long)malloc_usable_size(pointer);
+    void* result = __real_realloc(pointer, size);
+    // A failed realloc keeps the old block, a zero size frees it
+    if (result != NULL || size == 0) {
+        count_bytes((long long)malloc_usable_size(result) - old_size);
+    }
+    return result;
+}
+
+void __wrap_free(void* pointer) {
+    count_bytes(-(long long)malloc_usable_size(pointer));
+    __real_free(pointer);
+}
+
+char* __wrap_strdup(const char* str) {
+    size_t size = strlen(str) + 1;
+    char* copy = (char*)__wrap_malloc(size);
+    if (copy != NULL) {
+        memcpy(copy, str, size);
+    }
+    return copy;
+}
+
+long long heap_allocation_calls(void) {
+    return atomic_load_explicit(&allocation_calls, memory_order_relaxed);
+}
+
+// Blocks from inside the C library freed here can take the count below zero
+long long heap_bytes_in_use(void) {
+    long long bytes = atomic_load_explicit(&bytes_in_use, memory_order_relaxed);
+    return bytes > 0 ? bytes : 0;
+}
+
+long long heap_peak_bytes(void) {
+    return atomic_load_explicit(&peak_bytes, memory_order_relaxed);
+}
+
+void reset_heap_peak(void) {
+    atomic_store_explicit(&peak_bytes, heap_bytes_in_use(), memory_order_relaxed);
+}
@@ -0,0 +1,24 @@
+#ifndef HEAP_USAGE_H
+#define HEAP_USAGE_H
+
+/*
+ * Every program linking the shared files routes malloc, calloc, realloc,
+ * free and strdup through the wrappers in heap_usage.c (-Wl,--wrap in the
+ * Makefile). They count the calls and the usable size of the live blocks.
+ * Allocations made inside the C library, such as the line of getline() or
+ * the buffers of fopen(), are not seen.
+ */
+
+// Allocation calls (malloc, calloc, realloc, strdup) since the start
+long long heap_allocation_calls(void);
+
+// Bytes in the live blocks allocated through the wrappers
+long long heap_bytes_in_use(void);
+
+// Highest heap_bytes_in_use() since the start or the last reset
+long long heap_peak_bytes(void);
+
+// Restarting the peak at the current heap use
+void reset_heap_peak(void);
+
+#endif // HEAP_USAGE_H
@@ -0,0 +1,181 @@
+#include <math.h>
+#include "interval.h"
+
+// Rounding error allowed for the libm functions, pow included
+#define LIBM_ULPS 4
+
+Interval make_interval(double lo, double hi) {
+    if (isnan(lo) || isnan(hi)) {
+        return entire_interval();
+    }
+    Interval result = {lo, hi};
+    return result;
+}
+
+Interval empty_interval(void) {
+    Interval result = {INFINITY, -INFINITY};
+    return result;
+}
+
+Interval entire_interval(void) {
+    Interval result = {-INFINITY, INFINITY};
+    return result;
+}
+
+bool interval_is_empty(Interval a) {
+    return a.lo > a.hi;
+}
+
+bool interval_contains(Interval a, double value) {
+    return a.lo <= value && value <= a.hi;
+}
+
+Interval interval_hull(Interval a, Interval b) {
+    if (interval_is_empty(a)) {
+        return b;
+    }
+    if (interval_is_empty(b)) {
+        return a;
+    }
+    return make_interval(fmin(a.lo, b.lo), fmax(a.hi, b.hi));
+}
+
+Interval interval_clip(Interval a, double lo, double hi) {
+    if (interval_is_empty(a) || a.hi < lo || a.lo > hi) {
+        return empty_interval();
+    }
+    return make_interval(fmax(a.lo, lo), fmin(a.hi, hi));
+}
+
+Interval interval_widen(Interval a, int ulps) {
+    if (interval_is_empty(a)) {
+        return a;
+    }
+    for (int i = 0; i < ulps; i++) {
+        a.lo = nextafter(a.lo, -INFINITY);
+        a.hi = nextafter(a.hi, INFINITY);
+    }
+    return a;
+}
+
+// Smallest and largest of four values, the entire line if one of them is NaN
+static Interval hull_of_four(double p, double q, double r, double s) {
+    if (isnan(p) || isnan(q) || isnan(r) || isnan(s)) {
+        return entire_interval();
+    }
+    return make_interval(fmin(fmin(p, q), fmin(r, s)), fmax(fmax(p, q), fmax(r, s)));
+}
+
+Interval interval_add(Interval a, Interval b) {
+    if (interval_is_empty(a) || interval_is_empty(b)) {
+        return empty_interval();
+    }
+    return interval_widen(make_interval(a.lo + b.lo, a.hi + b.hi), 1);
+}
+
+Interval interval_sub(Interval a, Interval b) {
+    if (interval_is_empty(a) || interval_is_empty(b)) {
+        return empty_interval();
+    }
+    return interval_widen(make_interval(a.lo - b.hi, a.hi - b.lo), 1);
+}
+
+Interval interval_mul(Interval a, Interval b) {
+    if (interval_is_empty(a) || interval_is_empty(b)) {
+        return empty_interval();
+    }
+    return interval_widen(hull_of_four(a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi), 1);
+}
+
+Interval interval_div(Interval a, Interval b) {
+    if (interval_is_empty(a) || interval_is_empty(b) || (b.lo == 0 && b.hi == 0)) {
+        return empty_interval();
+    }
+    if (interval_contains(b, 0)) {
+        return entire_interval();  // arbitrarily large near the zero
+    }
+    return interval_widen(hull_of_four(a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi), 1);
+}
+
+Interval interval_neg(Interval a) {
+    if (interval_is_empty(a)) {
+        return a;
+    }
+    return make_interval(-a.hi, -a.lo);
+}
+
+Interval interval_recip(Interval a) {
+    return interval_pow(a, make_interval(-1, -1));
+}
+
+Interval interval_increasing(double (*function)(double), Interval a) {
+    if (interval_is_empty(a)) {
+        return a;
+    }
+    return interval_widen(make_interval(function(a.lo), function(a.hi)), LIBM_ULPS);
+}
+
+Interval interval_decreasing(double (*function)(double), Interval a) {
+    if (interval_is_empty(a)) {
+        return a;
+    }
+    return interval_widen(make_interval(function(a.hi), function(a.lo)), LIBM_ULPS);
+}
+
+// a^e for a constant exponent e
+static Interval power_by_constant(Interval a, double e) {
+    if (e == 0) {
+        return make_interval(1, 1);
+    }
+
+    if (e == floor(e) && fabs(e) < 9007199254740992.0) {
+        bool even = fmod(e, 2) == 0;
+        if (e < 0 && interval_contains(a, 0)) {
+            return entire_interval();  // a pole at zero
+        }
+        if (!even) {
+            return e > 0 ? make_interval(pow(a.lo, e), pow(a.hi, e))    // increasing
+                         : make_interval(pow(a.hi, e), pow(a.lo, e));   // decreasing on either side
+        }
+        if (a.lo >= 0) {
+            return e > 0 ? make_interval(pow(a.lo, e), pow(a.hi, e)) : make_interval(pow(a.hi, e), pow(a.lo, e));
+        }
+        if (a.hi <= 0) {
+            return e > 0 ? make_interval(pow(a.hi, e), pow(a.lo, e)) : make_interval(pow(a.lo, e), pow(a.hi, e));
+        }
+        return make_interval(0, fmax(pow(a.lo, e), pow(a.hi, e)));
+    }
+
+    // Fractional exponent, negative bases are undefined
+    a = interval_clip(a, 0, INFINITY);
+    if (interval_is_empty(a)) {
+        return a;
+    }
+    return e > 0 ? make_interval(pow(a.lo, e), pow(a.hi, e)) : make_interval(pow(a.hi, e), pow(a.lo, e));
+}
+
+Interval interval_pow(Interval a, Interval b) {
+    // pow(NaN, 0) and pow(1, NaN) are both 1
+    Interval one = empty_interval();
+    if ((!interval_is_empty(b) && interval_contains(b, 0)) || (!interval_is_empty(a) && interval_contains(a, 1))) {
+        one = make_interval(1, 1);
+    }
+    if (interval_is_empty(a) || interval_is_empty(b)) {
+        return one;
+    }
+
+    Interval result;
+    if (b.lo == b.hi) {
+        result = power_by_constant(a, b.lo);
+    } else if (a.lo > 0) {
+        // b * ln(a) is bilinear, so the extremes lie in the corners
+        result = hull_of_four(pow(a.lo, b.lo), pow(a.lo, b.hi), pow(a.hi, b.lo), pow(a.hi, b.hi));
+    } else {
+        result = entire_interval();
+    }
+    return interval_hull(interval_widen(result, LIBM_ULPS), one);
+}
+
+bool interval_outside(Interval a, double y_min, double y_max) {
+    return interval_is_empty(a) || a.hi < y_min || a.lo > y_max;
+}
@@ -0,0 +1,54 @@
+#ifndef INTERVAL_H
+#define INTERVAL_H
+
+#include <stdbool.h>
+
+/*
+ * Closed interval enclosing every defined (non-NaN) value an expression can
+ * take over a range of x. Undefined results are not tracked, because NaN is
+ * never drawn: an empty interval means the expression is undefined on the
+ * whole range. Bounds are rounded outwards, so the interval also encloses
+ * the results of the rounded point evaluation.
+ */
+typedef struct {
+    double lo;
+    double hi; // lo > hi for the empty interval
+} Interval;
+
+// Interval [lo, hi], a NaN bound gives the entire line
+Interval make_interval(double lo, double hi);
+
+// Interval of no values and of all values
+Interval empty_interval(void);
+Interval entire_interval(void);
+
+bool interval_is_empty(Interval a);
+bool interval_contains(Interval a, double value);
+
+// Smallest interval enclosing both
+Interval interval_hull(Interval a, Interval b);
+
+// Intersection with [lo, hi], used to cut an argument down to a function domain
+Interval interval_clip(Interval a, double lo, double hi);
+
+// Moving both bounds outwards by a number of ulps
+Interval interval_widen(Interval a, int ulps);
+
+// Operators with the semantics of the evaluators (division by zero is undefined)
+Interval interval_add(Interval a, Interval b);
+Interval interval_sub(Interval a, Interval b);
+Interval interval_mul(Interval a, Interval b);
+Interval interval_div(Interval a, Interval b);
+Interval interval_pow(Interval a, Interval b);
+Interval interval_neg(Interval a);
+// 1 / a with IEEE division, infinite at zero like pow(a, -1)
+Interval interval_recip(Interval a);
+
+// Image of an interval under a monotonic libm function
+Interval interval_increasing(double (*function)(double), Interval a);
+Interval interval_decreasing(double (*function)(double), Interval a);
+
+// Checking if an interval lies entirely outside [y_min, y_max]
+bool interval_outside(Interval a, double y_min, double y_max);
+
+#endif // INTERVAL_H
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "defs.h"
+#include "shuntingyard.h"
+#include "bytecode.h"
+#include "optimizer.h"
+#include "interval.h"
+
+// Random sub-intervals per expression and points checked inside each
+#define INTERVAL_TEST_RANGES 2000
+#define INTERVAL_TEST_POINTS 64
+
+// Expressions in the normalized form produced by remove_spaces(), every opcode and function
+static const char* INTERVAL_TEST_EXPRESSIONS[] = {
+    "x",
+    "-x+1",
+    "x*x-x",
+    "1/x",
+    "x/(x-1)",
+    "x^2+3*x+2",
+    "x^3-2*x",
+    "x^-2",
+    "x^-3",
+    "x^0.5",
+    "x^-0.5",
+    "(x^2+1)^-1",
+    "(x-1)^-3",
+    "2^x",
+    "x^x",
+    "(x/10)^(x/5)",
+    "abs(x)-3",
+    "exp(x)",
+    "ln(x)",
+    "log(x)",
+    "sin(x)",
+    "cos(x)",
+    "tan(x)",
+    "asin(x/10)",
+    "acos(x/10)",
+    "asin(x)",
+    "atan(x)",
+    "sinh(x)",
+    "cosh(x)",
+    "tanh(x)",
+    "sqrt(x)",
+    "ln(x)^0",
+    "(sin(x)+cos(x))*5",
+    "sinh(x)*tan(x)",
+    "exp(x^2)/(1+exp(x^2))",
+    "ln(abs(x))-log(x^2+1)",
+    "((x+1)*(x-1)+(x+2)*(x-2))/((x+3)*(x-3)+1)",
+    "sin(1/x)",
+    "sqrt(x)*sqrt(x)-x"
+};
+static const size_t NUM_INTERVAL_TEST_EXPRESSIONS =
+    sizeof(INTERVAL_TEST_EXPRESSIONS) / sizeof(INTERVAL_TEST_EXPRESSIONS[0]);
+
+// Random number in [lo, hi)
+static double random_in(double lo, double hi) {
+    return lo + (hi - lo) * ((double)rand() / ((double)RAND_MAX + 1));
+}
+
+// Checking that every point value of a program lies in its enclosure over random ranges
+static bool check_program(const char* expression, const char* what, const ExpressionProgram* program) {
+    for (int r = 0; r < INTERVAL_TEST_RANGES; r++) {
+        // Mostly narrow ranges, where the enclosure is tight and mistakes show
+        double center = random_in(-12, 12);
+        double width  = pow(10, random_in(-6, 1.5));
+        Interval x = make_interval(center - width / 2, center + width / 2);
+        Interval y = evaluate_program_interval(program, x);
+
+        for (int i = 0; i <= INTERVAL_TEST_POINTS; i++) {
+            double point = i == INTERVAL_TEST_POINTS ? x.hi : x.lo + (x.hi - x.lo) * i / INTERVAL_TEST_POINTS;
+            double value = evaluate_program(program, point);
+            if (!isnan(value) && !interval_contains(y, value)) {
+                printf("FAIL %-45s %-10s x=%.17g in [%.17g, %.17g]: %.17g not in [%.17g, %.17g]\n",
+                       expression, what, point, x.lo, x.hi, value, y.lo, y.hi);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(void) {
+    srand(12345);
+
+    size_t failures = 0;
+    for (size_t e = 0; e < NUM_INTERVAL_TEST_EXPRESSIONS; e++) {
+        const char* expression = INTERVAL_TEST_EXPRESSIONS[e];
+
+        TokenQueue queue;
+        init_token_queue(&queue);
+        ExpressionProgram program;
+        if (!parse_expression(expression, &queue) || !compile_expression(&queue, &program)) {
+            printf("FAIL %-45s cannot compile\n", expression);
+            clear_token_queue(&queue);
+            failures++;
+            continue;
+        }
+
+        bool passed = check_program(expression, "plain", &program);
+
+        ExprNode* tree = reduce_strength(simplify_expression_tree(build_expression_tree(&queue)));
+        ExpressionProgram optimized;
+        if (tree != NULL && compile_expression_tree(tree, &optimized)) {
+            passed = check_program(expression, "optimized", &optimized) && passed;
+            free_program(&optimized);
+        } else {
+            printf("FAIL %-45s cannot optimize\n", expression);
+            passed = false;
+        }
+        free_expression_tree(tree);
+
+        if (passed) {
+            printf("ok   %s\n", expression);
+        } else {
+            failures++;
+        }
+
+        free_program(&program);
+        clear_token_queue(&queue);
+    }
+
+    printf("%zu of %zu expressions stay inside their enclosures\n",
+           NUM_INTERVAL_TEST_EXPRESSIONS - failures, NUM_INTERVAL_TEST_EXPRESSIONS);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,406 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "jit.h"
+#include "function_registry.h"
+
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define JIT_SUPPORTED 1
+#include <sys/mman.h>
+#else
+#define JIT_SUPPORTED 0
+#endif
+
+#if JIT_SUPPORTED
+
+// Growing buffer for the generated code
+typedef struct {
+    unsigned char* bytes;
+    size_t length;
+    size_t capacity;
+    bool ok;
+} CodeBuffer;
+
+// Position of a RIP-relative displacement waiting for the constant area
+typedef struct {
+    size_t position; // offset of the disp32 field
+    size_t offset;   // byte offset of the constant in the constant area
+} Fixup;
+
+// State of the code generator
+typedef struct {
+    CodeBuffer code;
+    Fixup*     fixups;
+    size_t     num_fixups;
+    size_t     max_fixups;
+    int        max_depth; // value stack slots precede the program slots in the frame
+} JitEmitter;
+
+// Layout of the constant area: sign mask (16 bytes for xorpd), NaN, one, program constants
+#define JIT_SIGN_MASK_OFFSET 0
+#define JIT_NAN_OFFSET       16
+#define JIT_ONE_OFFSET       24
+#define JIT_CONSTANTS_OFFSET 32
+
+// SSE opcodes, the second byte after 0x0F
+#define SSE_MOVSD_LOAD  0x10
+#define SSE_MOVSD_STORE 0x11
+#define SSE_ADD         0x58
+#define SSE_MUL         0x59
+#define SSE_SUB         0x5C
+#define SSE_DIV         0x5E
+#define SSE_XOR         0x57
+#define SSE_UCOMI       0x2E
+
+// SSE prefixes: scalar double and packed double
+#define PREFIX_SD 0xF2
+#define PREFIX_PD 0x66
+
+static void emit_byte(CodeBuffer* code, unsigned char byte) {
+    if (!code->ok) {
+        return;
+    }
+    if (code->length == code->capacity) {
+        size_t capacity = code->capacity == 0 ? 1024 : code->capacity * 2;
+        unsigned char* bytes = (unsigned char*)realloc(code->bytes, capacity);
+        if (bytes == NULL) {
+            code->ok = false;
+            return;
+        }
+        code->bytes = bytes;
+        code->capacity = capacity;
+    }
+    code->bytes[code->length++] = byte;
+}
+
+static void emit_bytes(CodeBuffer* code, const unsigned char* bytes, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        emit_byte(code, bytes[i]);
+    }
+}
+
+static void emit_u32(CodeBuffer* code, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        emit_byte(code, (unsigned char)(value >> (8 * i)));
+    }
+}
+
+static void emit_u64(CodeBuffer* code, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        emit_byte(code, (unsigned char)(value >> (8 * i)));
+    }
+}
+
+// op xmm_reg, [rsp + disp32] (or the store form for SSE_MOVSD_STORE)
+static void emit_sse_frame(JitEmitter* emitter, unsigned char prefix, unsigned char opcode, int reg, int32_t disp) {
+    unsigned char bytes[] = {prefix, 0x0F, opcode, (unsigned char)(0x84 | (reg << 3)), 0x24};
+    emit_bytes(&emitter->code, bytes, sizeof(bytes));
+    emit_u32(&emitter->code, (uint32_t)disp);
+}
+
+// op xmm_reg, [rip + constant]
+static void emit_sse_constant(JitEmitter* emitter, unsigned char prefix, unsigned char opcode, int reg, size_t offset) {
+    unsigned char bytes[] = {prefix, 0x0F, opcode, (unsigned char)(0x05 | (reg << 3))};
+    emit_bytes(&emitter->code, bytes, sizeof(bytes));
+
+    if (emitter->num_fixups == emitter->max_fixups) {
+        size_t max_fixups = emitter->max_fixups == 0 ? 64 : emitter->max_fixups * 2;
+        Fixup* fixups = (Fixup*)realloc(emitter->fixups, max_fixups * sizeof(Fixup));
+        if (fixups == NULL) {
+            emitter->code.ok = false;
+            return;
+        }
+        emitter->fixups = fixups;
+        emitter->max_fixups = max_fixups;
+    }
+    Fixup fixup = {emitter->code.length, offset};
+    emitter->fixups[emitter->num_fixups++] = fixup;
+    emit_u32(&emitter->code, 0);
+}
+
+// Frame displacement of a value stack entry and of a program slot
+static int32_t stack_disp(int index) {
+    return 8 * index;
+}
+
+static int32_t slot_disp(const JitEmitter* emitter, int slot) {
+    return 8 * (emitter->max_depth + slot);
+}
+
+// Loading a value stack entry into xmm_reg and storing xmm0 back
+static void load_stack(JitEmitter* emitter, int reg, int index) {
+    emit_sse_frame(emitter, PREFIX_SD, SSE_MOVSD_LOAD, reg, stack_disp(index));
+}
+
+static void store_stack(JitEmitter* emitter, int index) {
+    emit_sse_frame(emitter, PREFIX_SD, SSE_MOVSD_STORE, 0, stack_disp(index));
+}
+
+// mov rax, imm64; call rax
+static void emit_call(JitEmitter* emitter, uintptr_t address) {
+    unsigned char mov_rax[] = {0x48, 0xB8};
+    emit_bytes(&emitter->code, mov_rax, sizeof(mov_rax));
+    emit_u64(&emitter->code, (uint64_t)address);
+    unsigned char call_rax[] = {0xFF, 0xD0};
+    emit_bytes(&emitter->code, call_rax, sizeof(call_rax));
+}
+
+// Emitting one bytecode instruction, `top` is the stack index before it
+static int emit_instruction(JitEmitter* emitter, const ExpressionProgram* program, Instruction instruction, int top) {
+    CodeBuffer* code = &emitter->code;
+    size_t constant = JIT_CONSTANTS_OFFSET + 8 * (size_t)instruction.operand;
+
+    switch (instruction.code) {
+        case OP_PUSH_CONST:
+            emit_sse_constant(emitter, PREFIX_SD, SSE_MOVSD_LOAD, 0, constant);
+            store_stack(emitter, top + 1);
+            return top + 1;
+        case OP_PUSH_X: {
+            // movsd xmm0, [rbx + r14*8]
+            unsigned char load_x[] = {PREFIX_SD, 0x42, 0x0F, SSE_MOVSD_LOAD, 0x04, 0xF3};
+            emit_bytes(code, load_x, sizeof(load_x));
+            store_stack(emitter, top + 1);
+            return top + 1;
+        }
+        case OP_ADD:
+        case OP_SUB:
+        case OP_MUL: {
+            unsigned char opcode = instruction.code == OP_ADD ? SSE_ADD :
+                                   instruction.code == OP_SUB ? SSE_SUB : SSE_MUL;
+            load_stack(emitter, 0, top - 1);
+            emit_sse_frame(emitter, PREFIX_SD, opcode, 0, stack_disp(top));
+            store_stack(emitter, top - 1);
+            return top - 1;
+        }
+        case OP_DIV: {
+            load_stack(emitter, 0, top - 1);
+            load_stack(emitter, 1, top);
+            // divsd xmm0, xmm1; xorpd xmm2, xmm2; ucomisd xmm1, xmm2
+            unsigned char divide[] = {PREFIX_SD, 0x0F, SSE_DIV, 0xC1,
+                                      PREFIX_PD, 0x0F, SSE_XOR, 0xD2,
+                                      PREFIX_PD, 0x0F, SSE_UCOMI, 0xCA};
+            emit_bytes(code, divide, sizeof(divide));
+            // A zero divisor yields NaN: jp +10; jne +8; movsd xmm0, [NaN]
+            unsigned char skip[] = {0x7A, 0x0A, 0x75, 0x08};
+            emit_bytes(code, skip, sizeof(skip));
+            emit_sse_constant(emitter, PREFIX_SD, SSE_MOVSD_LOAD, 0, JIT_NAN_OFFSET);
+            store_stack(emitter, top - 1);
+            return top - 1;
+        }
+        case OP_POW:
+            load_stack(emitter, 0, top - 1);
+            load_stack(emitter, 1, top);
+            emit_call(emitter, (uintptr_t)&pow);
+            store_stack(emitter, top - 1);
+            return top - 1;
+        case OP_NEG:
+            load_stack(emitter, 0, top);
+            emit_sse_constant(emitter, PREFIX_PD, SSE_XOR, 0, JIT_SIGN_MASK_OFFSET);
+            store_stack(emitter, top);
+            return top;
+        case OP_RECIP:
+            // movsd xmm0, [one]; divsd xmm0, [stack], without the zero check of OP_DIV
+            emit_sse_constant(emitter, PREFIX_SD, SSE_MOVSD_LOAD, 0, JIT_ONE_OFFSET);
+            emit_sse_frame(emitter, PREFIX_SD, SSE_DIV, 0, stack_disp(top));
+            store_stack(emitter, top);
+            return top;
+        case OP_FUNC: {
+            const FunctionInfo* info = get_function_info(instruction.operand);
+            if (info == NULL) {
+                code->ok = false;
+                return top;
+            }
+            load_stack(emitter, 0, top);
+            if (info->in_domain == NULL) {
+                // Straight into libm
+                emit_call(emitter, (uintptr_t)info->scalar);
+            } else {
+                // mov edi, id; the registry applies the domain check
+                emit_byte(code, 0xBF);
+                emit_u32(code, instruction.operand);
+                emit_call(emitter, (uintptr_t)&apply_function);
+            }
+            store_stack(emitter, top);
+            return top;
+        }
+        case OP_STORE:
+            load_stack(emitter, 0, top);
+            emit_sse_frame(emitter, PREFIX_SD, SSE_MOVSD_STORE, 0, slot_disp(emitter, instruction.operand));
+            return top;
+        case OP_LOAD:
+            emit_sse_frame(emitter, PREFIX_SD, SSE_MOVSD_LOAD, 0, slot_disp(emitter, instruction.operand));
+            store_stack(emitter, top + 1);
+            return top + 1;
+        case OP_HORNER: {
+            // result stays in xmm0 across the fma(result, t, c) calls
+            int degree = (int)program->constants[instruction.operand];
+            emit_sse_constant(emitter, PREFIX_SD, SSE_MOVSD_LOAD, 0, constant + 8);
+            for (int i = 1; i <= degree; i++) {
+                load_stack(emitter, 1, top);
+                emit_sse_constant(emitter, PREFIX_SD, SSE_MOVSD_LOAD, 2, constant + 8 + 8 * (size_t)i);
+                emit_call(emitter, (uintptr_t)&fma);
+            }
+            store_stack(emitter, top);
+            return top;
+        }
+        default:
+            code->ok = false;
+            return top;
+    }
+}
+
+// Emitting the whole function: prologue, loop over the points, epilogue
+static void emit_function(JitEmitter* emitter, const ExpressionProgram* program) {
+    CodeBuffer* code = &emitter->code;
+
+    // Value stack and slots, rounded up to keep calls 16-byte aligned
+    uint32_t frame = (uint32_t)(8 * (program->max_depth + program->num_slots));
+    frame = (frame + 15) & ~15u;
+
+    // push rbp; mov rbp, rsp; push rbx; push r12; push r13; push r14; sub rsp, frame
+    unsigned char prologue[] = {0x55, 0x48, 0x89, 0xE5, 0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x48, 0x81, 0xEC};
+    emit_bytes(code, prologue, sizeof(prologue));
+    emit_u32(code, frame);
+
+    // mov rbx, rdi (xs); mov r12, rsi (ys); mov r13, rdx (n); xor r14d, r14d (i)
+    unsigned char arguments[] = {0x48, 0x89, 0xFB, 0x49, 0x89, 0xF4, 0x49, 0x89, 0xD5, 0x45, 0x31, 0xF6};
+    emit_bytes(code, arguments, sizeof(arguments));
+
+    // test r13, r13; jz end
+    unsigned char check[] = {0x4D, 0x85, 0xED, 0x0F, 0x84};
+    emit_bytes(code, check, sizeof(check));
+    size_t jump_to_end = code->length;
+    emit_u32(code, 0);
+
+    size_t loop = code->length;
+    int top = -1;
+    for (size_t i = 0; i < program->length && code->ok; i++) {
+        top = emit_instruction(emitter, program, program->code[i], top);
+    }
+
+    // movsd xmm0, [rsp]; movsd [r12 + r14*8], xmm0
+    load_stack(emitter, 0, 0);
+    unsigned char store_y[] = {PREFIX_SD, 0x43, 0x0F, SSE_MOVSD_STORE, 0x04, 0xF4};
+    emit_bytes(code, store_y, sizeof(store_y));
+
+    // inc r14; cmp r14, r13; jb loop
+    unsigned char next[] = {0x49, 0xFF, 0xC6, 0x4D, 0x39, 0xEE, 0x0F, 0x82};
+    emit_bytes(code, next, sizeof(next));
+    emit_u32(code, (uint32_t)(int32_t)(loop - (code->length + 4)));
+
+    if (code->ok) {
+        uint32_t forward = (uint32_t)(code->length - (jump_to_end + 4));
+        memcpy(&code->bytes[jump_to_end], &forward, sizeof(forward));
+    }
+
+    // add rsp, frame; pop r14; pop r13; pop r12; pop rbx; pop rbp; ret
+    unsigned char add_rsp[] = {0x48, 0x81, 0xC4};
+    emit_bytes(code, add_rsp, sizeof(add_rsp));
+    emit_u32(code, frame);
+    unsigned char epilogue[] = {0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0x5D, 0xC3};
+    emit_bytes(code, epilogue, sizeof(epilogue));
+}
+
+#endif // JIT_SUPPORTED
+
+bool jit_available(void) {
+    return JIT_SUPPORTED;
+}
+
+bool jit_compile(const ExpressionProgram* program, JitProgram* jit) {
+    if (program == NULL || jit == NULL) {
+        return false;
+    }
+
+    memset(jit, 0, sizeof(JitProgram));
+    if (program->code == NULL) {
+        return false;
+    }
+
+#if JIT_SUPPORTED
+    JitEmitter emitter;
+    memset(&emitter, 0, sizeof(JitEmitter));
+    emitter.code.ok   = true;
+    emitter.max_depth = program->max_depth;
+
+    emit_function(&emitter, program);
+    if (!emitter.code.ok) {
+        free(emitter.code.bytes);
+        free(emitter.fixups);
+        return false;
+    }
+
+    // Code, then the 16-byte aligned constant area
+    size_t constants_start = (emitter.code.length + 15) & ~(size_t)15;
+    size_t total = constants_start + JIT_CONSTANTS_OFFSET + program->num_constants * sizeof(double);
+
+    void* memory = mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        free(emitter.code.bytes);
+        free(emitter.fixups);
+        return false;
+    }
+
+    unsigned char* bytes = (unsigned char*)memory;
+    memcpy(bytes, emitter.code.bytes, emitter.code.length);
+
+    double* constants = (double*)(bytes + constants_start);
+    constants[0] = -0.0; // sign mask for xorpd
+    constants[1] = -0.0;
+    constants[2] = NAN;  // the interpreter's division by zero result
+    constants[3] = 1.0;  // dividend of OP_RECIP
+    if (program->num_constants > 0) {
+        memcpy(bytes + constants_start + JIT_CONSTANTS_OFFSET, program->constants,
+               program->num_constants * sizeof(double));
+    }
+
+    // RIP-relative displacements count from the end of the disp32 field
+    for (size_t i = 0; i < emitter.num_fixups; i++) {
+        int32_t disp = (int32_t)(constants_start + emitter.fixups[i].offset - (emitter.fixups[i].position + 4));
+        memcpy(bytes + emitter.fixups[i].position, &disp, sizeof(disp));
+    }
+
+    free(emitter.code.bytes);
+    free(emitter.fixups);
+
+    if (mprotect(memory, total, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, total);
+        return false;
+    }
+
+    jit->memory   = memory;
+    jit->size     = total;
+    jit->function = (JitFunction)memory;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void jit_evaluate_batch(const JitProgram* jit, const double* xs, double* ys, size_t n) {
+    if (jit == NULL || jit->function == NULL || xs == NULL || ys == NULL) {
+        return;
+    }
+    jit->function(xs, ys, n);
+}
+
+double jit_evaluate(const JitProgram* jit, double x) {
+    double y = NAN;
+    jit_evaluate_batch(jit, &x, &y, 1);
+    return y;
+}
+
+void jit_free(JitProgram* jit) {
+    if (jit == NULL) {
+        return;
+    }
+
+#if JIT_SUPPORTED
+    if (jit->memory != NULL) {
+        munmap(jit->memory, jit->size);
+    }
+#endif
+    memset(jit, 0, sizeof(JitProgram));
+}
@@ -0,0 +1,43 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "bytecode.h"
+
+// Machine code signature: ys[i] = f(xs[i]) for i < n
+typedef void (*JitFunction)(const double* xs, double* ys, size_t n);
+
+// Native code compiled from an ExpressionProgram
+typedef struct {
+    void*       memory;   // executable mapping
+    size_t      size;     // size of the mapping
+    JitFunction function; // entry point
+} JitProgram;
+
+// Checking if the JIT backend exists on this platform (x86-64 with mmap)
+bool jit_available(void);
+
+/**
+ * @brief Compiles a program into x86-64 SSE2 machine code.
+ *
+ * @param program Program produced by compile_expression() or compile_expression_tree()
+ * @param jit JIT program to fill
+ * @return true if successful, false if the platform is unsupported or mapping failed.
+ *
+ * The generated code mirrors the interpreter instruction by instruction and
+ * calls the same libm and registry functions, so its results are bit-identical
+ * to evaluate_program(). The constants are copied, the program may be freed.
+ */
+bool jit_compile(const ExpressionProgram* program, JitProgram* jit);
+
+// Evaluating a JIT program for n points
+void jit_evaluate_batch(const JitProgram* jit, const double* xs, double* ys, size_t n);
+
+// Evaluating a JIT program for a single x
+double jit_evaluate(const JitProgram* jit, double x);
+
+// Releasing the executable mapping
+void jit_free(JitProgram* jit);
+
+#endif // JIT_H
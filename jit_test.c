@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "defs.h"
+#include "shuntingyard.h"
+#include "bytecode.h"
+#include "optimizer.h"
+#include "jit.h"
+
+// Number of regular grid points, the default [-10, 10] range at a coarser step
+#define JIT_TEST_GRID_POINTS 2001
+
+// Expressions in the normalized form produced by remove_spaces(), every opcode and function
+static const char* JIT_TEST_EXPRESSIONS[] = {
+    "x",
+    "-x",
+    "-(-x)",
+    "5",
+    "x+1-x*2",
+    "x/3",
+    "1/x",
+    "x/(x-1)",
+    "x^2+3*x+2",
+    "x^3-2*x^2+x-7",
+    "x^0.5",
+    "x^-2",
+    "x^-1",
+    "(x^2+1)^-1",
+    "abs(x)^-0.5",
+    "2^x",
+    "x^x",
+    "abs(x)",
+    "exp(x)",
+    "ln(x)",
+    "log(x)",
+    "sin(x)",
+    "cos(x)",
+    "tan(x)",
+    "asin(x/10)",
+    "acos(x/10)",
+    "asin(x)",
+    "atan(x)",
+    "sinh(x)",
+    "cosh(x)",
+    "tanh(x)",
+    "sqrt(x)",
+    "(sin(x)+cos(x))*5",
+    "sin(x)*sin(x)+cos(x)*sin(x)",
+    "exp(x^2)/(1+exp(x^2))",
+    "ln(abs(x))-log(x^2+1)",
+    "((x+1)*(x-1)+(x+2)*(x-2))/((x+3)*(x-3)+1)",
+    "sqrt(x)*sqrt(x)-x",
+    "-(x^2)+-x"
+};
+static const size_t NUM_JIT_TEST_EXPRESSIONS = sizeof(JIT_TEST_EXPRESSIONS) / sizeof(JIT_TEST_EXPRESSIONS[0]);
+
+// Special arguments appended to the grid
+static const double JIT_TEST_SPECIAL_VALUES[] = {
+    0.0, -0.0, 1.0, -1.0, 1e-300, -1e-300, 1e300, -1e300, 710.0, -745.0, INFINITY, -INFINITY, NAN
+};
+static const size_t NUM_JIT_TEST_SPECIAL_VALUES = sizeof(JIT_TEST_SPECIAL_VALUES) / sizeof(JIT_TEST_SPECIAL_VALUES[0]);
+
+// Comparing two results bit by bit, reporting the first mismatch
+static bool same_bits(const char* expression, const char* what, double x, double expected, double actual) {
+    if (memcmp(&expected, &actual, sizeof(double)) == 0) {
+        return true;
+    }
+    printf("FAIL %-45s %-10s x=%-24.17g expected %.17g, got %.17g\n", expression, what, x, expected, actual);
+    return false;
+}
+
+// Checking one program against its reference results
+static bool check_program(const char* expression, const char* what, const ExpressionProgram* program,
+                          const double* xs, const double* expected, double* ys, size_t n) {
+    JitProgram jit;
+    if (!jit_compile(program, &jit)) {
+        printf("FAIL %-45s %-10s JIT compilation failed\n", expression, what);
+        return false;
+    }
+
+    jit_evaluate_batch(&jit, xs, ys, n);
+
+    bool passed = true;
+    for (size_t i = 0; i < n && passed; i++) {
+        passed = same_bits(expression, what, xs[i], expected[i], ys[i]);
+    }
+    for (size_t i = 0; i < n && passed; i += 97) {
+        passed = same_bits(expression, what, xs[i], expected[i], jit_evaluate(&jit, xs[i]));
+    }
+
+    jit_free(&jit);
+    return passed;
+}
+
+int main(void) {
+    if (!jit_available()) {
+        printf("JIT is not available on this platform, nothing to test\n");
+        return EXIT_SUCCESS;
+    }
+
+    size_t n = JIT_TEST_GRID_POINTS + NUM_JIT_TEST_SPECIAL_VALUES;
+    double* xs       = (double*)malloc(n * sizeof(double));
+    double* expected = (double*)malloc(n * sizeof(double));
+    double* ys       = (double*)malloc(n * sizeof(double));
+    if (xs == NULL || expected == NULL || ys == NULL) {
+        free(xs);
+        free(expected);
+        free(ys);
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < JIT_TEST_GRID_POINTS; i++) {
+        xs[i] = DEFAULT_MIN + i * 0.01;
+    }
+    memcpy(xs + JIT_TEST_GRID_POINTS, JIT_TEST_SPECIAL_VALUES, sizeof(JIT_TEST_SPECIAL_VALUES));
+
+    size_t failures = 0;
+    for (size_t e = 0; e < NUM_JIT_TEST_EXPRESSIONS; e++) {
+        const char* expression = JIT_TEST_EXPRESSIONS[e];
+
+        TokenQueue queue;
+        init_token_queue(&queue);
+        ExpressionProgram program;
+        if (!parse_expression(expression, &queue) || !compile_expression(&queue, &program)) {
+            printf("FAIL %-45s cannot compile\n", expression);
+            clear_token_queue(&queue);
+            failures++;
+            continue;
+        }
+
+        // The unoptimized program against the RPN evaluator
+        for (size_t i = 0; i < n; i++) {
+            expected[i] = evaluate_expression(&queue, xs[i]);
+        }
+        bool passed = check_program(expression, "rpn", &program, xs, expected, ys, n);
+
+        // The optimized program against the interpreter running the same program
+        ExprNode* tree = reduce_strength(simplify_expression_tree(build_expression_tree(&queue)));
+        ExpressionProgram optimized;
+        if (tree != NULL && compile_expression_tree(tree, &optimized)) {
+            for (size_t i = 0; i < n; i++) {
+                expected[i] = evaluate_program(&optimized, xs[i]);
+            }
+            passed = check_program(expression, "optimized", &optimized, xs, expected, ys, n) && passed;
+            free_program(&optimized);
+        } else {
+            printf("FAIL %-45s cannot optimize\n", expression);
+            passed = false;
+        }
+        free_expression_tree(tree);
+
+        if (passed) {
+            printf("ok   %s\n", expression);
+        } else {
+            failures++;
+        }
+
+        free_program(&program);
+        clear_token_queue(&queue);
+    }
+
+    printf("%zu of %zu expressions match bit for bit\n", NUM_JIT_TEST_EXPRESSIONS - failures, NUM_JIT_TEST_EXPRESSIONS);
+
+    free(xs);
+    free(expected);
+    free(ys);
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -2,140 +2,80 @@
 #include <stdlib.h>
 #include "parse_input.h"
 #include "defs.h"
-#include "shuntingyard.h"
-#include "postscriptexport.h"
-#include "parser_utils.h"
+#include "render.h"
+#include "batch.h"
+#include "render_daemon.h"
+#include "trace.h"
 
 int main(int argc, char* argv[]) {
-    if (argc < 2 || argc > 4 || argv == NULL) {
-        return ERROR_ARG_COUNT;
-    }
-
-    // Check argument count
-    if (!check_arg_count(argc)) {
-        printf("Usage: %s <function> <output_file> [<limits>]\n", argv[0]);
+    // Strip the --options, the rest are positional arguments
+    unsigned long long started = trace_clock();
+    program_options_t options;
+    argc = extract_options(&options, argc, argv);
+    if (argc < 0) {
         return ERROR_ARG_COUNT;
     }
 
-    // Allocate params
-    input_params_t* params = allocate_params();
-    if (!params) {
-        return ERROR_MEMORY_ALLOCATION;
-    }
-
-    // Extract function
-    if (!extract_function_param(params, argv[1])) {
-        free_input_params(params);
-        return ERROR_INVALID_FUNCTION;
-    }
-
-    // Extract output file
-    if (!extract_output_file_param(params, argv[2])) {
-        free_input_params(params);
-        return ERROR_OUTPUT_FILE;
-    }
-
-    // Parse limits if provided
-    if (argc == 4) {
-        if (!parse_limits_param(params, argv[3])) {
-            free_input_params(params);
-            return ERROR_INVALID_LIMITS;
+    // Spans are recorded from here on and written when the process exits
+    if (options.trace_path != NULL) {
+        if (!start_trace(options.trace_path, started)) {
+            fprintf(stderr, "Error: Cannot record the trace %s\n", options.trace_path);
         }
-    } else {
-        set_default_limits(params);
+        set_trace_thread_name("main");
+        end_trace_span("extract_options", started, NULL, 0);
     }
 
-    // Normalize function
-    if (!normalize_function_param(params)) {
-        free_input_params(params);
-        return ERROR_INVALID_FUNCTION;
+    // Many plots in one process, the job list replaces the positional arguments
+    if (options.batch_path != NULL) {
+        if (argc != 1) {
+            printf("Usage: %s [options] [--jobs N] [--trace <file>] --batch <jobs_file|->\n", argv[0]);
+            return ERROR_ARG_COUNT;
+        }
+        debug_output = false;
+        return run_batch(options.batch_path, &options);
     }
 
-    // Validate expression
-    if (!validate_expression_param(params)) {
-        free_input_params(params);
-        return ERROR_INVALID_FUNCTION;
+    // Long-running server, the requests carry the positional arguments
+    if (options.daemon_path != NULL) {
+        if (argc != 1) {
+            printf("Usage: %s [--cache N] [--trace <file>] --daemon <socket>\n", argv[0]);
+            return ERROR_ARG_COUNT;
+        }
+        debug_output = false;
+        return run_daemon(options.daemon_path, &options);
     }
 
-    // Check limits
-    if (!check_limits_valid(params)) {
-        free_input_params(params);
-        return ERROR_INVALID_LIMITS;
+    if (argc < 2 || argc > 4 || argv == NULL) {
+        return ERROR_ARG_COUNT;
     }
 
-    // Proceed with the rest of the program
-    printf("[DEBUG]: All input parameters are valid.\n");
-
-    printf("---------------------------------\n");
-    printf("Parsed input:\n");
-    printf("Function: %s\n",         params->function_str);
-    printf("Output file: %s\n",      params->output_file_str);
-    printf("X limits: [%lf, %lf]\n", params->x_min, params->x_max);
-    printf("Y limits: [%lf, %lf]\n", params->y_min, params->y_max);
-    printf("---------------------------------\n");
-
-    TokenQueue token_queue;
-    init_token_queue(&token_queue);
-    bool success = parse_expression(params->function_str, &token_queue);
-    if (!success) {
-        printf("Unsuccessful expression parsing!\n");
-        clear_token_queue(&token_queue);
-        free_input_params(params);
-        return ERROR_INVALID_FUNCTION;
+    // Check argument count
+    if (!check_arg_count(argc)) {
+        printf("Usage: %s [--jit] [--threads N] [--adaptive[=tolerance]] [--no-cull] [--decimate[=columns]] [--simplify[=tolerance]] [--compact[=relative|arrays]] [--quantize[=steps]] [--async] [--jobs N] [--batch <jobs_file|->] [--cache N] [--daemon <socket>] [--render-cache <dir>] [--render-cache-size MB] [--stats[=json]] [--profile-eval] [--trace <file>] <function> <output_file> [<limits>]\n", argv[0]);
+        return ERROR_ARG_COUNT;
     }
 
-    // Calculate the number of points based on x limits and X_STEP_VALUE
-    int num_points = (int)round((params->x_max - params->x_min) / X_STEP_VALUE);
-    int real_num_points = 0;
-
-    // Dynamically allocate memory for x and y arrays
-    double* x = (double*)malloc(num_points * sizeof(double));
-    double* y = (double*)malloc(num_points * sizeof(double));
-
-    if (x == NULL || y == NULL) {
-        perror("Failed to allocate memory");
-        if (x != NULL) {
-            free(x);
-        }
-        if (y != NULL) {
-            free(y);
+    // Render the plot
+    render_context_t context;
+    init_render_context(&context);
+    render_stats_t stats;
+    if (options.stats_format != STATS_OFF) {
+        init_render_stats(&stats);
+        context.stats = &stats;
+        // The JSON object is the only output, so it can be piped into other tools
+        if (options.stats_format == STATS_JSON) {
+            debug_output = false;
         }
-        free_input_params(params);
-        clear_token_queue(&token_queue);
-        return ERROR_MEMORY_ALLOCATION;
     }
-
-    // Fill x and y arrays
-    double current_x = params->x_min;
-    for (int i = 0; i < num_points; i++) {
-        double result = evaluate_expression(&token_queue, current_x);
-
-        if (result >= params->y_min && result <= params->y_max) {
-            x[real_num_points] = current_x;
-            y[real_num_points] = result;
-            ++real_num_points;
-        }
-        current_x += X_STEP_VALUE;
+    if (options.profile_eval) {
+        context.profile_output = stdout;
     }
+    int status = render_plot(&context, &options, argv[1], argv[2], argc == 4 ? argv[3] : NULL);
+    free_render_context(&context);
 
-    char interval_label[100];  // Buffer for the interval string
-
-    // Generate the interval label using params min and max values
-    snprintf(interval_label, sizeof(interval_label), INTERVAL_STRING_FORMAT,
-             params->x_min, params->x_max, params->y_min, params->y_max);
-
-    // Export data to PostScript file
-    export_to_postscript(params->output_file_str, x, y, real_num_points,
-                         params->x_min, params->x_max, params->y_min, params->y_max,
-                         params->function_str, interval_label);
-
-    // Free allocated memory
-    free(x);
-    free(y);
-
-    // Cleanup
-    clear_token_queue(&token_queue);
-    free_input_params(params);
+    if (options.stats_format != STATS_OFF) {
+        print_render_stats(stdout, &stats, options.stats_format);
+    }
 
-    return SUCCESS;
+    return status;
 }
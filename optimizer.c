@@ -0,0 +1,492 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "optimizer.h"
+#include "function_registry.h"
+#include "defs.h"
+
+// Checking if a node is the constant `value`, zeros are compared with their sign
+static bool is_const_value(const ExprNode* node, double value) {
+    return node->kind == NODE_CONST && node->value == value &&
+           signbit(node->value) == signbit(value);
+}
+
+// Checking if two subtrees are the same expression, constants compared bit by bit
+static bool same_tree(const ExprNode* a, const ExprNode* b) {
+    if (a == NULL || b == NULL) {
+        return a == b;
+    }
+    if (a->kind != b->kind || a->op != b->op || a->func_id != b->func_id || a->degree != b->degree ||
+        memcmp(&a->value, &b->value, sizeof(double)) != 0) {
+        return false;
+    }
+    if (a->kind == NODE_POLYNOMIAL &&
+        memcmp(a->coefficients, b->coefficients, (a->degree + 1) * sizeof(double)) != 0) {
+        return false;
+    }
+    return same_tree(a->left, b->left) && same_tree(a->right, b->right);
+}
+
+// Checking if a function never returns -0, not even for a -0 argument
+static bool never_negative_zero_function(int func_id) {
+    static const char* const NAMES[] = {FUNC_ABS, FUNC_EXP, FUNC_COSH};
+    for (size_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); i++) {
+        if (func_id == find_function(NAMES[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*
+ * Checking if a node may evaluate to -0. Used to decide whether a + 0 can be
+ * replaced by a, which only differs for a = -0 (-0 + 0 = +0). The sampler
+ * never passes x = -0, but evaluate_program() may be called with any x.
+ */
+static bool may_be_negative_zero(const ExprNode* node) {
+    switch (node->kind) {
+        case NODE_CONST:
+            return node->value == 0 && signbit(node->value);
+        case NODE_FUNCTION:
+            return !never_negative_zero_function(node->func_id);
+        case NODE_BINARY:
+            if (node->op == OPERATOR_PLUS) {
+                return may_be_negative_zero(node->left) && may_be_negative_zero(node->right);
+            }
+            if (node->op == OPERATOR_MINUS) {
+                return may_be_negative_zero(node->left);
+            }
+            // a*a has the sign of a squared
+            return node->op != OPERATOR_MULTIPLY || !same_tree(node->left, node->right);
+        default:
+            return true;
+    }
+}
+
+// Replacing a node by one of its children, the rest of the node is released
+static ExprNode* replace_with_child(ExprNode* node, ExprNode* keep) {
+    if (node->left != keep) {
+        free_expression_tree(node->left);
+    }
+    if (node->right != keep) {
+        free_expression_tree(node->right);
+    }
+    free(node);
+    return keep;
+}
+
+// Turning a node into a constant, its children are released
+static ExprNode* replace_with_const(ExprNode* node, double value) {
+    free_expression_tree(node->left);
+    free_expression_tree(node->right);
+    node->kind  = NODE_CONST;
+    node->value = value;
+    node->left  = node->right = NULL;
+    return node;
+}
+
+// Turning a binary node into the negation of one of its operands
+static ExprNode* replace_with_negation(ExprNode* node, ExprNode* operand) {
+    ExprNode* other = node->left == operand ? node->right : node->left;
+    free_expression_tree(other);
+    node->kind  = NODE_NEGATE;
+    node->left  = operand;
+    node->right = NULL;
+    return node;
+}
+
+// Simplifying a binary node whose operands are already simplified
+static ExprNode* simplify_binary(ExprNode* node) {
+    ExprNode* left  = node->left;
+    ExprNode* right = node->right;
+
+    if (left->kind == NODE_CONST && right->kind == NODE_CONST) {
+        return replace_with_const(node, calculate_operator(node->op, left->value, right->value));
+    }
+
+    switch (node->op) {
+        case OPERATOR_PLUS:
+            // a + -0 = a, a + 0 = a unless a is -0
+            if (is_const_value(right, -0.0) ||
+                (is_const_value(right, 0.0) && !may_be_negative_zero(left))) {
+                return replace_with_child(node, left);
+            }
+            if (is_const_value(left, -0.0) ||
+                (is_const_value(left, 0.0) && !may_be_negative_zero(right))) {
+                return replace_with_child(node, right);
+            }
+            // a + -(b) = a - b
+            if (right->kind == NODE_NEGATE) {
+                node->op    = OPERATOR_MINUS;
+                node->right = right->left;
+                free(right);
+            }
+            return node;
+        case OPERATOR_MINUS:
+            // a - 0 = a
+            if (is_const_value(right, 0.0)) {
+                return replace_with_child(node, left);
+            }
+            // a - -(b) = a + b
+            if (right->kind == NODE_NEGATE) {
+                node->op    = OPERATOR_PLUS;
+                node->right = right->left;
+                free(right);
+            }
+            return node;
+        case OPERATOR_MULTIPLY:
+            if (is_const_value(right, 1.0)) {
+                return replace_with_child(node, left);
+            }
+            if (is_const_value(left, 1.0)) {
+                return replace_with_child(node, right);
+            }
+            if (is_const_value(right, -1.0)) {
+                return replace_with_negation(node, left);
+            }
+            if (is_const_value(left, -1.0)) {
+                return replace_with_negation(node, right);
+            }
+            return node;
+        case OPERATOR_DIVIDE:
+            if (is_const_value(right, 1.0)) {
+                return replace_with_child(node, left);
+            }
+            return node;
+        case OPERATOR_POWER:
+            // pow(a, 0) and pow(1, a) are 1 even for NaN
+            if (right->kind == NODE_CONST && right->value == 0) {
+                return replace_with_const(node, 1.0);
+            }
+            if (is_const_value(left, 1.0)) {
+                return replace_with_const(node, 1.0);
+            }
+            if (is_const_value(right, 1.0)) {
+                return replace_with_child(node, left);
+            }
+            return node;
+        default:
+            return node;
+    }
+}
+
+ExprNode* simplify_expression_tree(ExprNode* root) {
+    if (root == NULL) {
+        return NULL;
+    }
+
+    switch (root->kind) {
+        case NODE_CONST:
+        case NODE_VARIABLE:
+        case NODE_POLYNOMIAL:
+        case NODE_RECIPROCAL:
+            return root;
+        case NODE_NEGATE: {
+            root->left = simplify_expression_tree(root->left);
+            ExprNode* operand = root->left;
+            if (operand->kind == NODE_CONST) {
+                return replace_with_const(root, -operand->value);
+            }
+            // -(-(a)) = a
+            if (operand->kind == NODE_NEGATE) {
+                ExprNode* inner = operand->left;
+                free(operand);
+                free(root);
+                return inner;
+            }
+            return root;
+        }
+        case NODE_FUNCTION:
+            root->left = simplify_expression_tree(root->left);
+            if (root->left->kind == NODE_CONST) {
+                return replace_with_const(root, apply_function(root->func_id, root->left->value));
+            }
+            return root;
+        case NODE_BINARY:
+            root->left  = simplify_expression_tree(root->left);
+            root->right = simplify_expression_tree(root->right);
+            return simplify_binary(root);
+    }
+    return root;
+}
+
+// Polynomial in x with ascending coefficients, c[i] belongs to x^i
+typedef struct {
+    double c[POLYNOMIAL_MAX_DEGREE + 1];
+    int degree;
+} Polynomial;
+
+// Multiplying two polynomials, false if the degree gets too high
+static bool multiply_polynomials(const Polynomial* a, const Polynomial* b, Polynomial* result) {
+    if (a->degree + b->degree > POLYNOMIAL_MAX_DEGREE) {
+        return false;
+    }
+
+    Polynomial product;
+    memset(&product, 0, sizeof(Polynomial));
+    product.degree = a->degree + b->degree;
+    for (int i = 0; i <= a->degree; i++) {
+        for (int j = 0; j <= b->degree; j++) {
+            product.c[i + j] += a->c[i] * b->c[j];
+        }
+    }
+    while (product.degree > 0 && product.c[product.degree] == 0) {
+        product.degree--;
+    }
+    *result = product;
+    return true;
+}
+
+// Number of nonzero coefficients
+static int count_terms(const Polynomial* p) {
+    int terms = 0;
+    for (int i = 0; i <= p->degree; i++) {
+        if (p->c[i] != 0) {
+            terms++;
+        }
+    }
+    return terms;
+}
+
+/*
+ * Collecting the coefficients of a subtree that is already a sum of monomials
+ * c*x^k: finite constants, x, +, -, unary minus, products of monomials and
+ * non-negative integer powers of a monomial. Products and powers of sums are
+ * not multiplied out, (x-1000)^8 in monomial form loses every digit to
+ * cancellation near x = 1000. Zero factors and terms cancelling out are not
+ * folded either, x*0 and x^2-x^2 are NaN where the terms overflow.
+ */
+static bool collect_polynomial(const ExprNode* node, Polynomial* p) {
+    memset(p, 0, sizeof(Polynomial));
+
+    switch (node->kind) {
+        case NODE_CONST:
+            p->c[0] = node->value;
+            return isfinite(node->value);
+        case NODE_VARIABLE:
+            p->c[1]   = 1.0;
+            p->degree = 1;
+            return true;
+        case NODE_NEGATE:
+            if (!collect_polynomial(node->left, p)) {
+                return false;
+            }
+            for (int i = 0; i <= p->degree; i++) {
+                p->c[i] = -p->c[i];
+            }
+            return true;
+        case NODE_BINARY:
+            break;
+        default:
+            return false;
+    }
+
+    Polynomial lhs, rhs;
+    if (!collect_polynomial(node->left, &lhs)) {
+        return false;
+    }
+
+    if (node->op == OPERATOR_POWER) {
+        double exponent = node->right->kind == NODE_CONST ? node->right->value : -1.0;
+        if (exponent < 0 || exponent > POLYNOMIAL_MAX_DEGREE || exponent != floor(exponent) ||
+            exponent * lhs.degree > POLYNOMIAL_MAX_DEGREE || count_terms(&lhs) != 1) {
+            return false;
+        }
+        p->c[0] = 1.0;
+        for (int i = 0; i < (int)exponent; i++) {
+            multiply_polynomials(p, &lhs, p);
+        }
+        return true;
+    }
+
+    if (!collect_polynomial(node->right, &rhs)) {
+        return false;
+    }
+
+    switch (node->op) {
+        case OPERATOR_PLUS:
+        case OPERATOR_MINUS:
+            p->degree = lhs.degree > rhs.degree ? lhs.degree : rhs.degree;
+            for (int i = 0; i <= p->degree; i++) {
+                p->c[i] = node->op == OPERATOR_PLUS ? lhs.c[i] + rhs.c[i] : lhs.c[i] - rhs.c[i];
+                if (p->c[i] == 0 && (lhs.c[i] != 0 || rhs.c[i] != 0)) {
+                    return false;
+                }
+            }
+            return true;
+        case OPERATOR_MULTIPLY:
+            // Scaling a sum is not exact either, 3*(x-1000) differs from 3*x-3000 near x = 1000
+            if (count_terms(&lhs) != 1 || count_terms(&rhs) != 1) {
+                return false;
+            }
+            return multiply_polynomials(&lhs, &rhs, p);
+        default:
+            return false;
+    }
+}
+
+// Horner form pays off for at least two terms and degree 2, monomials go to powers
+static bool worth_horner(const Polynomial* p) {
+    return p->degree >= 2 && count_terms(p) >= 2;
+}
+
+// Replacing maximal polynomial subtrees in x by Horner nodes, top-down
+static ExprNode* detect_polynomials(ExprNode* node) {
+    if (node == NULL) {
+        return NULL;
+    }
+
+    if (node->kind == NODE_BINARY || node->kind == NODE_NEGATE) {
+        Polynomial p;
+        if (collect_polynomial(node, &p) && worth_horner(&p)) {
+            // Horner coefficients go from the highest degree down
+            double coefficients[POLYNOMIAL_MAX_DEGREE + 1];
+            for (int i = 0; i <= p.degree; i++) {
+                coefficients[i] = p.c[p.degree - i];
+            }
+            ExprNode* horner = make_polynomial_node(coefficients, p.degree, make_variable_node());
+            if (horner != NULL) {
+                free_expression_tree(node);
+                return horner;
+            }
+        }
+    }
+
+    node->left  = detect_polynomials(node->left);
+    node->right = detect_polynomials(node->right);
+    return node;
+}
+
+// Building base^n for n >= 1 by squaring, the DAG later shares the copies
+static ExprNode* build_power(const ExprNode* base, int n) {
+    if (n == 1) {
+        return clone_expression_tree(base);
+    }
+
+    ExprNode* half   = build_power(base, n / 2);
+    ExprNode* square = make_binary_node(OPERATOR_MULTIPLY, half, clone_expression_tree(half));
+    if (n % 2 == 1) {
+        return make_binary_node(OPERATOR_MULTIPLY, square, clone_expression_tree(base));
+    }
+    return square;
+}
+
+// Enclosing the values of a subtree for any finite x, entire where unknown
+static Interval enclose_node(const ExprNode* node) {
+    switch (node->kind) {
+        case NODE_CONST:
+            return isnan(node->value) ? empty_interval() : make_interval(node->value, node->value);
+        case NODE_VARIABLE:
+            return make_interval(-DBL_MAX, DBL_MAX);
+        case NODE_NEGATE:
+            return interval_neg(enclose_node(node->left));
+        case NODE_FUNCTION:
+            return apply_function_interval(node->func_id, enclose_node(node->left));
+        case NODE_RECIPROCAL:
+            return interval_recip(enclose_node(node->left));
+        case NODE_BINARY: {
+            Interval a = enclose_node(node->left);
+            Interval b = enclose_node(node->right);
+            switch (node->op) {
+                case OPERATOR_PLUS:     return interval_add(a, b);
+                case OPERATOR_MINUS:    return interval_sub(a, b);
+                case OPERATOR_MULTIPLY:
+                    // a*a is a square, not any product of two values of a
+                    return same_tree(node->left, node->right) ? interval_pow(a, make_interval(2, 2))
+                                                              : interval_mul(a, b);
+                case OPERATOR_DIVIDE:   return interval_div(a, b);
+                case OPERATOR_POWER:    return interval_pow(a, b);
+                default:                return entire_interval();
+            }
+        }
+        default:
+            return entire_interval();
+    }
+}
+
+// Rewriting a^c for a constant c into multiplications, sqrt and a reciprocal
+static ExprNode* reduce_power(ExprNode* node) {
+    ExprNode* base = node->left;
+    double exponent = node->right->value;
+    ExprNode* result = NULL;
+
+    if (fabs(exponent) == 0.5) {
+        // sqrt(-inf) is NaN while pow(-inf, 0.5) is +inf
+        int sqrt_id = find_function(FUNC_SQRT);
+        if (sqrt_id < 0 || !(enclose_node(base).lo > -INFINITY)) {
+            return node;
+        }
+        // sqrt(-0) is -0 while pow(-0, 0.5) is +0, adding +0 turns -0 into +0 and keeps everything else
+        ExprNode* argument = clone_expression_tree(base);
+        if (may_be_negative_zero(base)) {
+            argument = make_binary_node(OPERATOR_PLUS, argument, make_const_node(0.0));
+        }
+        result = make_function_node(sqrt_id, argument);
+    } else if (exponent == floor(exponent) && fabs(exponent) >= 1 && fabs(exponent) <= POWER_MAX_EXPONENT) {
+        result = build_power(base, (int)fabs(exponent));
+    } else {
+        return node;
+    }
+
+    // Not a division, which is NaN at zero: 1/a^c is +-inf where a^c is +-0, as pow(a, -c)
+    if (exponent < 0) {
+        result = make_reciprocal_node(result);
+    }
+    if (result == NULL) {
+        return node; // out of memory, keep pow()
+    }
+    free_expression_tree(node);
+    return result;
+}
+
+// Reducing constant powers bottom-up
+static ExprNode* reduce_powers(ExprNode* node) {
+    if (node == NULL) {
+        return NULL;
+    }
+
+    node->left  = reduce_powers(node->left);
+    node->right = reduce_powers(node->right);
+
+    if (node->kind == NODE_BINARY && node->op == OPERATOR_POWER && node->right->kind == NODE_CONST) {
+        return reduce_power(node);
+    }
+    return node;
+}
+
+ExprNode* reduce_strength(ExprNode* root) {
+    // Powers first, so their guards see the sums and products instead of opaque Horner nodes
+    root = reduce_powers(root);
+    return detect_polynomials(root);
+}
+
+ExprNode* optimize_expression(const TokenQueue* queue) {
+    if (queue == NULL) {
+        return NULL;
+    }
+
+    ExprNode* root = build_expression_tree(queue);
+    if (root == NULL) {
+        DEBUG_PRINTF("[DEBUG]: Expression is malformed, nothing to optimize\n");
+        return NULL;
+    }
+
+    if (debug_output) {
+        printf("[DEBUG]: Expression before optimization: ");
+        print_expression_tree(stdout, root);
+        printf("\n");
+    }
+
+    root = simplify_expression_tree(root);
+    root = reduce_strength(root);
+
+    if (debug_output) {
+        printf("[DEBUG]: Expression after optimization:  ");
+        print_expression_tree(stdout, root);
+        printf("\n");
+    }
+
+    return root;
+}
@@ -0,0 +1,49 @@
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include <stdbool.h>
+#include "shuntingyard.h"
+#include "expression_tree.h"
+
+/**
+ * @brief Folds constant subtrees and applies safe algebraic identities.
+ *
+ * @param root Root of the expression tree, consumed by the call
+ * @return ExprNode* Root of the simplified tree.
+ *
+ * Only rewrites that give the same IEEE result for every x are applied,
+ * so x*0 or x-x are kept as they are (NaN and inf would change).
+ */
+ExprNode* simplify_expression_tree(ExprNode* root);
+
+// Highest integer exponent rewritten into multiplications
+#define POWER_MAX_EXPONENT 32
+
+/**
+ * @brief Replaces pow() by cheaper operations.
+ *
+ * @param root Root of the expression tree, consumed by the call
+ * @return ExprNode* Root of the rewritten tree.
+ *
+ * Constant integer powers become multiplication chains (exponentiation by
+ * squaring), negative ones their reciprocal, which is +-inf at +-0 like pow().
+ * a^0.5 becomes sqrt(a), or sqrt(a + 0) where a may be -0, unless a may be
+ * -inf. Sums of at least two monomials in x then become Horner nodes
+ * evaluated with fma(); products and powers of sums are kept, multiplying
+ * them out is numerically unstable. These rewrites may change the last bits
+ * of a result, and a reciprocal of an overflowing chain is 0 where pow()
+ * returns a value below DBL_MIN.
+ */
+ExprNode* reduce_strength(ExprNode* root);
+
+/**
+ * @brief Builds and optimizes the expression tree of a parsed RPN queue.
+ *
+ * @param queue Token queue produced by parse_expression()
+ * @return ExprNode* Optimized tree, or NULL if the queue is malformed.
+ *
+ * Prints the expression before and after the passes as debug output.
+ */
+ExprNode* optimize_expression(const TokenQueue* queue);
+
+#endif // OPTIMIZER_H
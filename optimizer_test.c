@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "shuntingyard.h"
+#include "bytecode.h"
+#include "optimizer.h"
+
+// Grid points per expression, spread over the neighbourhood of its interesting point
+#define OPTIMIZER_TEST_GRID_POINTS 2001
+
+// Relative difference allowed between the optimized program and the RPN evaluator
+#define OPTIMIZER_TEST_TOLERANCE 1e-12
+
+// Expression in normalized form, checked on [center - width, center + width]
+typedef struct {
+    const char* expression;
+    double      center;
+    double      width;
+} optimizer_test_case_t;
+
+// Shifted powers and products of sums that must not be multiplied out, and folds that must keep NaN and inf
+static const optimizer_test_case_t OPTIMIZER_TEST_CASES[] = {
+    {"(x-1000)^8", 1000.0, 10.0},
+    {"(x-1000)^3", 1000.0, 1.0},
+    {"(x+3)^5", -3.0, 0.5},
+    {"(x-0.5)^16", 0.5, 0.25},
+    {"(2*x-1)^7", 0.5, 0.01},
+    {"3*(x-1000)", 1000.0, 0.01},
+    {"(x-1)*(x-1)*(x-1)", 1.0, 0.1},
+    {"(x-3)^2+(x-3)^4", 3.0, 0.5},
+    {"(x+1)*(x-1)", 1.0, 1e-6},
+    {"(x-100)^2-1", 101.0, 1e-6},
+    {"(x*0+2)^3000000000+x^2", 0.0, 10.0},
+    {"x*0+x^2", 0.0, 10.0},
+    {"x^2-x^2+x", 0.0, 10.0},
+    {"x^2+3*x+2", 5.0, 5.0},
+    {"x+0", 0.0, 1.0},
+    {"0+x", 0.0, 1.0},
+    {"x-0", 0.0, 1.0},
+    {"ln(x)^-0.5", 1.0, 1.0},
+    {"ln(x)^0.5", 1.0, 1.0},
+    {"x^-0.5", 1.0, 1.0},
+    {"x^0.5", 1.0, 1.0},
+    {"x^-2", 0.0, 1.0},
+    {"(x-2)^-3", 2.0, 1.0},
+    {"exp(x)^-2", 0.0, 10.0},
+    {"(x^2+1)^-2", 0.0, 10.0},
+    {"x^-1", 0.0, 1.0},
+    {"(x-3)^-2", 3.0, 1.0},
+    {"(x^2+1)^-1", 0.0, 10.0},
+    {"(x^2+1)^0.5", 0.0, 10.0},
+    {"abs(x)^0.5", 0.0, 10.0},
+    {"exp(x)^0.5", 0.0, 10.0},
+    {"cosh(x)^-0.5", 0.0, 10.0},
+    {"(x*x)^-0.5", 0.0, 10.0}
+};
+static const size_t NUM_OPTIMIZER_TEST_CASES = sizeof(OPTIMIZER_TEST_CASES) / sizeof(OPTIMIZER_TEST_CASES[0]);
+
+// Expression in normalized form and the tree print_expression_tree() shows after reduce_strength()
+typedef struct {
+    const char* expression;
+    const char* reduced;
+} optimizer_form_case_t;
+
+// Rewrites that must happen, and the pow() calls that must stay
+static const optimizer_form_case_t OPTIMIZER_FORM_CASES[] = {
+    {"x^-1", "recip(x)"},
+    {"x^-2", "recip((x * x))"},
+    {"x^3", "((x * x) * x)"},
+    {"(x^2+1)^-1", "recip(horner[1, 0, 1](x))"},
+    {"(x^2+1)^0.5", "sqrt(horner[1, 0, 1](x))"},
+    {"x^0.5", "sqrt((x + 0))"},
+    {"x^-0.5", "recip(sqrt((x + 0)))"},
+    {"abs(x)^0.5", "sqrt(abs(x))"},
+    {"exp(x)^0.5", "sqrt(exp(x))"},
+    {"cosh(x)^-0.5", "recip(sqrt(cosh(x)))"},
+    {"x^2+3*x+2", "horner[1, 3, 2](x)"},
+    {"(x-1000)^3", "(((x - 1000) * (x - 1000)) * (x - 1000))"},
+    {"x+0", "(x + 0)"},
+    {"ln(x)^0.5", "(ln(x) ^ 0.5)"},
+    {"x^0.3", "(x ^ 0.3)"}
+};
+static const size_t NUM_OPTIMIZER_FORM_CASES = sizeof(OPTIMIZER_FORM_CASES) / sizeof(OPTIMIZER_FORM_CASES[0]);
+
+// Special arguments appended to the grid, the limits and so x are always finite
+static const double OPTIMIZER_TEST_SPECIAL_VALUES[] = {
+    0.0, -0.0, 1.0, -1.0, 1e-300, -1e-300, 1e-200, 1e300, -1e300, 1e160, -1e160
+};
+static const size_t NUM_OPTIMIZER_TEST_SPECIAL_VALUES =
+    sizeof(OPTIMIZER_TEST_SPECIAL_VALUES) / sizeof(OPTIMIZER_TEST_SPECIAL_VALUES[0]);
+
+// Equal up to the tolerance, NaN only against NaN, infinities and zeros only against the same signed value;
+// below DBL_MIN only the sign counts, a reciprocal of an overflowing power chain is 0 there
+static bool close_enough(double expected, double actual) {
+    if (isnan(expected) || isnan(actual)) {
+        return isnan(expected) && isnan(actual);
+    }
+    if (fabs(expected) < DBL_MIN || fabs(actual) < DBL_MIN) {
+        return fabs(expected) < DBL_MIN && fabs(actual) < DBL_MIN && signbit(expected) == signbit(actual);
+    }
+    if (isinf(expected) || isinf(actual)) {
+        return expected == actual;
+    }
+    return fabs(actual - expected) <= OPTIMIZER_TEST_TOLERANCE * fabs(expected);
+}
+
+// Checking the optimized program at one argument, reporting a mismatch
+static bool check_point(const char* expression, const TokenQueue* queue, const ExpressionProgram* program, double x) {
+    double expected = evaluate_expression(queue, x);
+    double actual = evaluate_program(program, x);
+    if (close_enough(expected, actual)) {
+        return true;
+    }
+    printf("FAIL %-30s x=%-24.17g expected %.17g, got %.17g\n", expression, x, expected, actual);
+    return false;
+}
+
+// Checking the printed tree after reduce_strength(), false on a mismatch
+static bool check_form(const optimizer_form_case_t* test) {
+    TokenQueue queue;
+    init_token_queue(&queue);
+    if (!parse_expression(test->expression, &queue)) {
+        printf("FAIL %-30s cannot parse\n", test->expression);
+        clear_token_queue(&queue);
+        return false;
+    }
+    ExprNode* tree = reduce_strength(simplify_expression_tree(build_expression_tree(&queue)));
+    clear_token_queue(&queue);
+
+    char* text = NULL;
+    size_t size = 0;
+    FILE* stream = open_memstream(&text, &size);
+    if (stream == NULL) {
+        free_expression_tree(tree);
+        return false;
+    }
+    print_expression_tree(stream, tree);
+    fclose(stream);
+    free_expression_tree(tree);
+
+    bool passed = text != NULL && strcmp(text, test->reduced) == 0;
+    if (!passed) {
+        printf("FAIL %-30s reduced to %s, expected %s\n", test->expression, text != NULL ? text : "?", test->reduced);
+    }
+    free(text);
+    return passed;
+}
+
+int main(void) {
+    size_t form_failures = 0;
+    for (size_t e = 0; e < NUM_OPTIMIZER_FORM_CASES; e++) {
+        if (!check_form(&OPTIMIZER_FORM_CASES[e])) {
+            form_failures++;
+        }
+    }
+    printf("%zu of %zu expressions reduce to the expected form\n", NUM_OPTIMIZER_FORM_CASES - form_failures,
+           NUM_OPTIMIZER_FORM_CASES);
+
+    size_t failures = 0;
+    for (size_t e = 0; e < NUM_OPTIMIZER_TEST_CASES; e++) {
+        const optimizer_test_case_t* test = &OPTIMIZER_TEST_CASES[e];
+
+        TokenQueue queue;
+        init_token_queue(&queue);
+        if (!parse_expression(test->expression, &queue)) {
+            printf("FAIL %-30s cannot parse\n", test->expression);
+            clear_token_queue(&queue);
+            failures++;
+            continue;
+        }
+
+        ExprNode* tree = reduce_strength(simplify_expression_tree(build_expression_tree(&queue)));
+        ExpressionProgram optimized;
+        if (tree == NULL || !compile_expression_tree(tree, &optimized)) {
+            printf("FAIL %-30s cannot optimize\n", test->expression);
+            free_expression_tree(tree);
+            clear_token_queue(&queue);
+            failures++;
+            continue;
+        }
+
+        // The optimized program against the RPN evaluator of the unchanged expression
+        bool passed = true;
+        for (int i = 0; i < OPTIMIZER_TEST_GRID_POINTS && passed; i++) {
+            double x = test->center + test->width * (2.0 * i / (OPTIMIZER_TEST_GRID_POINTS - 1) - 1.0);
+            passed = check_point(test->expression, &queue, &optimized, x);
+        }
+        for (size_t i = 0; i < NUM_OPTIMIZER_TEST_SPECIAL_VALUES && passed; i++) {
+            passed = check_point(test->expression, &queue, &optimized, OPTIMIZER_TEST_SPECIAL_VALUES[i]);
+        }
+
+        if (passed) {
+            printf("ok   %s\n", test->expression);
+        } else {
+            failures++;
+        }
+
+        free_program(&optimized);
+        free_expression_tree(tree);
+        clear_token_queue(&queue);
+    }
+
+    printf("%zu of %zu expressions match the RPN evaluator\n", NUM_OPTIMIZER_TEST_CASES - failures,
+           NUM_OPTIMIZER_TEST_CASES);
+    return failures == 0 && form_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,24 +1,206 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include "function_normalizer.h"
 #include "parser_utils.h"
 #include "parse_input.h"
+#include "defs.h"
+#include "sampler.h"
+#include "decimation.h"
+#include "postscriptexport.h"
+#include "batch.h"
+#include "expression_cache.h"
+#include "render_cache.h"
+
+bool debug_output = true;
+
+// Parsing the value of an option taking a count from 1 to `limit`
+static bool parse_count(const char* option, const char* arg, int limit, int* count) {
+    if (arg == NULL) {
+        DEBUG_PRINTF("[DEBUG]: Missing value of %s\n", option);
+        return false;
+    }
+
+    char* end = NULL;
+    long value = strtol(arg, &end, 10);
+    if (end == arg || *end != END_STRING_CHAR || value < 1 || value > limit) {
+        DEBUG_PRINTF("[DEBUG]: Invalid value of %s: %s\n", option, arg);
+        return false;
+    }
+    *count = (int)value;
+    return true;
+}
+
+// Parsing the value of an option taking a positive finite number
+static bool parse_positive_value(const char* option, const char* arg, double* value) {
+    char* end = NULL;
+    double parsed = strtod(arg, &end);
+    if (end == arg || *end != END_STRING_CHAR || !(parsed > 0) || isinf(parsed)) {
+        DEBUG_PRINTF("[DEBUG]: Invalid value of %s: %s\n", option, arg);
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
 
 // Function to check argument count
 bool check_arg_count(int argc) {
     if (argc < 3 || argc > 4) {
-        printf("[DEBUG]: Incorrect number of arguments: %d\n", argc);
+        DEBUG_PRINTF("[DEBUG]: Incorrect number of arguments: %d\n", argc);
         return false;
     }
     return true;
 }
 
+int extract_options(program_options_t* options, int argc, char* argv[]) {
+    if (options == NULL || argv == NULL) {
+        return argc;
+    }
+
+    memset(options, 0, sizeof(program_options_t));
+    options->num_threads = 1;
+    options->num_workers = 1;
+    options->cache_entries = EXPRESSION_CACHE_ENTRIES;
+    options->render_cache_mb = RENDER_CACHE_DEFAULT_MB;
+    options->cull = true;
+
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--jit") == 0) {
+            options->use_jit = true;
+            DEBUG_PRINTF("[DEBUG]: JIT evaluation requested\n");
+        } else if (strcmp(argv[i], "--interpreter") == 0) {
+            options->use_jit = false;
+        } else if (strcmp(argv[i], "--threads") == 0) {
+            if (!parse_count("--threads", i + 1 < argc ? argv[++i] : NULL, SAMPLER_MAX_THREADS, &options->num_threads)) {
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            if (!parse_count("--threads", argv[i] + 10, SAMPLER_MAX_THREADS, &options->num_threads)) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--jobs") == 0) {
+            if (!parse_count("--jobs", i + 1 < argc ? argv[++i] : NULL, BATCH_MAX_WORKERS, &options->num_workers)) {
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--jobs=", 7) == 0) {
+            if (!parse_count("--jobs", argv[i] + 7, BATCH_MAX_WORKERS, &options->num_workers)) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            if (i + 1 >= argc) {
+                DEBUG_PRINTF("[DEBUG]: Missing job list of --batch\n");
+                return -1;
+            }
+            options->batch_path = argv[++i];
+        } else if (strncmp(argv[i], "--batch=", 8) == 0) {
+            options->batch_path = argv[i] + 8;
+        } else if (strcmp(argv[i], "--daemon") == 0) {
+            if (i + 1 >= argc) {
+                DEBUG_PRINTF("[DEBUG]: Missing socket of --daemon\n");
+                return -1;
+            }
+            options->daemon_path = argv[++i];
+        } else if (strncmp(argv[i], "--daemon=", 9) == 0) {
+            options->daemon_path = argv[i] + 9;
+        } else if (strcmp(argv[i], "--cache") == 0) {
+            if (!parse_count("--cache", i + 1 < argc ? argv[++i] : NULL, EXPRESSION_CACHE_MAX_ENTRIES, &options->cache_entries)) {
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--cache=", 8) == 0) {
+            if (!parse_count("--cache", argv[i] + 8, EXPRESSION_CACHE_MAX_ENTRIES, &options->cache_entries)) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--render-cache") == 0) {
+            if (i + 1 >= argc) {
+                DEBUG_PRINTF("[DEBUG]: Missing directory of --render-cache\n");
+                return -1;
+            }
+            options->render_cache_dir = argv[++i];
+        } else if (strncmp(argv[i], "--render-cache=", 15) == 0) {
+            options->render_cache_dir = argv[i] + 15;
+        } else if (strcmp(argv[i], "--render-cache-size") == 0) {
+            if (!parse_count("--render-cache-size", i + 1 < argc ? argv[++i] : NULL, RENDER_CACHE_MAX_MB, &options->render_cache_mb)) {
+                return -1;
+            }
+        } else if (strncmp(argv[i], "--render-cache-size=", 20) == 0) {
+            if (!parse_count("--render-cache-size", argv[i] + 20, RENDER_CACHE_MAX_MB, &options->render_cache_mb)) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--stats=text") == 0) {
+            options->stats_format = STATS_TEXT;
+        } else if (strcmp(argv[i], "--stats=json") == 0) {
+            options->stats_format = STATS_JSON;
+        } else if (strncmp(argv[i], "--stats=", 8) == 0) {
+            DEBUG_PRINTF("[DEBUG]: Invalid value of --stats: %s\n", argv[i] + 8);
+            return -1;
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            if (i + 1 >= argc) {
+                DEBUG_PRINTF("[DEBUG]: Missing file of --trace\n");
+                return -1;
+            }
+            options->trace_path = argv[++i];
+        } else if (strncmp(argv[i], "--trace=", 8) == 0) {
+            options->trace_path = argv[i] + 8;
+        } else if (strcmp(argv[i], "--profile-eval") == 0) {
+            options->profile_eval = true;
+        } else if (strcmp(argv[i], "--async") == 0) {
+            options->async_export = true;
+        } else if (strcmp(argv[i], "--no-cull") == 0) {
+            options->cull = false;
+        } else if (strcmp(argv[i], "--adaptive") == 0) {
+            options->tolerance = ADAPTIVE_TOLERANCE;
+        } else if (strncmp(argv[i], "--adaptive=", 11) == 0) {
+            if (!parse_positive_value("--adaptive", argv[i] + 11, &options->tolerance)) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--simplify") == 0) {
+            options->simplify_tolerance = SIMPLIFY_TOLERANCE;
+        } else if (strncmp(argv[i], "--simplify=", 11) == 0) {
+            if (!parse_positive_value("--simplify", argv[i] + 11, &options->simplify_tolerance)) {
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--compact") == 0 || strcmp(argv[i], "--compact=arrays") == 0) {
+            options->path_encoding = PS_PATH_ARRAYS;
+        } else if (strcmp(argv[i], "--compact=relative") == 0) {
+            options->path_encoding = PS_PATH_RELATIVE;
+        } else if (strncmp(argv[i], "--compact=", 10) == 0) {
+            DEBUG_PRINTF("[DEBUG]: Invalid value of --compact: %s\n", argv[i] + 10);
+            return -1;
+        } else if (strcmp(argv[i], "--quantize") == 0) {
+            options->grid_units = PS_COMPACT_UNITS_PER_POINT;
+        } else if (strncmp(argv[i], "--quantize=", 11) == 0) {
+            if (!parse_positive_value("--quantize", argv[i] + 11, &options->grid_units)) {
+                return -1;
+            }
+            if (options->grid_units > PS_COMPACT_MAX_UNITS_PER_POINT) {
+                DEBUG_PRINTF("[DEBUG]: The grid of --quantize is at most %d steps per point\n", PS_COMPACT_MAX_UNITS_PER_POINT);
+                return -1;
+            }
+        } else if (strcmp(argv[i], "--decimate") == 0) {
+            options->decimate_columns = DECIMATION_COLUMNS_PER_UNIT;
+        } else if (strncmp(argv[i], "--decimate=", 11) == 0) {
+            if (!parse_positive_value("--decimate", argv[i] + 11, &options->decimate_columns)) {
+                return -1;
+            }
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    // Only the compact encodings are written on the grid
+    if (options->grid_units > 0 && options->path_encoding == PS_PATH_ABSOLUTE) {
+        options->path_encoding = PS_PATH_ARRAYS;
+    }
+    argv[kept] = NULL;
+    return kept;
+}
+
 // Function to allocate and initialize input_params_t
 input_params_t* allocate_params() {
     input_params_t* params = malloc(sizeof(input_params_t));
     if (!params) {
-        printf("[DEBUG]: Memory allocation error for params\n");
+        DEBUG_PRINTF("[DEBUG]: Memory allocation error for params\n");
         return NULL;
     }
     memset(params, 0, sizeof(input_params_t));  // Initialize all fields to zero
@@ -33,10 +215,10 @@ bool extract_function_param(input_params_t* params, const char* arg) {
 
     params->function_str = extract_function(arg);
     if (!params->function_str) {
-        printf("[DEBUG]: Failed to extract function string from argv[1]\n");
+        DEBUG_PRINTF("[DEBUG]: Failed to extract function string from argv[1]\n");
         return false;
     }
-    printf("[DEBUG]: Extracted function: %s\n", params->function_str);
+    DEBUG_PRINTF("[DEBUG]: Extracted function: %s\n", params->function_str);
     return true;
 }
 
@@ -48,10 +230,10 @@ bool extract_output_file_param(input_params_t* params, const char* arg) {
 
     params->output_file_str = extract_output_file(arg);
     if (!params->output_file_str) {
-        printf("[DEBUG]: Failed to extract output file name from argv[2]\n");
+        DEBUG_PRINTF("[DEBUG]: Failed to extract output file name from argv[2]\n");
         return false;
     }
-    printf("[DEBUG]: Extracted output file name: %s\n", params->output_file_str);
+    DEBUG_PRINTF("[DEBUG]: Extracted output file name: %s\n", params->output_file_str);
     return true;
 }
 
@@ -61,12 +243,12 @@ bool parse_limits_param(input_params_t* params, const char* arg) {
         return false;
     }
 
-    printf("[DEBUG]: Parsing limits from argv[3]: %s\n", arg);
+    DEBUG_PRINTF("[DEBUG]: Parsing limits from argv[3]: %s\n", arg);
     if (!parse_limits(arg, &params->x_min, &params->x_max, &params->y_min, &params->y_max)) {
-        printf("[DEBUG]: Failed to parse limits\n");
+        DEBUG_PRINTF("[DEBUG]: Failed to parse limits\n");
         return false;
     }
-    printf("[DEBUG]: Successfully parsed limits: x_min=%f, x_max=%f, y_min=%f, y_max=%f\n",
+    DEBUG_PRINTF("[DEBUG]: Successfully parsed limits: x_min=%f, x_max=%f, y_min=%f, y_max=%f\n",
            params->x_min, params->x_max, params->y_min, params->y_max);
     params->has_limits = true;
     return true;
@@ -80,12 +262,12 @@ bool normalize_function_param(input_params_t* params) {
 
     char* normalized_function = remove_spaces(params->function_str);
     if (!normalized_function) {
-        printf("[DEBUG]: Failed to normalize function string\n");
+        DEBUG_PRINTF("[DEBUG]: Failed to normalize function string\n");
         return false;
     }
     free(params->function_str);
     params->function_str = normalized_function;
-    printf("[DEBUG]: Normalized function: %s\n", params->function_str);
+    DEBUG_PRINTF("[DEBUG]: Normalized function: %s\n", params->function_str);
     return true;
 }
 
@@ -96,10 +278,10 @@ bool validate_expression_param(input_params_t* params) {
     }
 
     if (!is_valid_expression(params->function_str)) {
-        printf("[DEBUG]: Function contains invalid characters or is incorrect\n");
+        DEBUG_PRINTF("[DEBUG]: Function contains invalid characters or is incorrect\n");
         return false;
     }
-    printf("[DEBUG]: Function is valid\n");
+    DEBUG_PRINTF("[DEBUG]: Function is valid\n");
     return true;
 }
 
@@ -109,11 +291,12 @@ bool check_limits_valid(input_params_t* params) {
         return false;
     }
 
-    if (params->x_min >= params->x_max || params->y_min >= params->y_max) {
-        printf("[DEBUG]: Limits are invalid\n");
+    if (!isfinite(params->x_min) || !isfinite(params->x_max) || !isfinite(params->y_min) ||
+        !isfinite(params->y_max) || params->x_min >= params->x_max || params->y_min >= params->y_max) {
+        DEBUG_PRINTF("[DEBUG]: Limits are invalid\n");
         return false;
     }
-    printf("[DEBUG]: Limits are valid\n");
+    DEBUG_PRINTF("[DEBUG]: Limits are valid\n");
     return true;
 }
 
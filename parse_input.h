@@ -2,6 +2,8 @@
 #define INPUT_PARAMS_H
 
 #include <stdbool.h>
+#include "postscriptexport.h"
+#include "render_stats.h"
 
 // Error codes
 #define SUCCESS                 0 // Successful program completion
@@ -10,6 +12,9 @@
 #define ERROR_OUTPUT_FILE       3 // Error creating or writing to file
 #define ERROR_INVALID_LIMITS    4 // Error parsing limits
 #define ERROR_MEMORY_ALLOCATION 5 // Memory allocation failed
+#define ERROR_BATCH_INPUT       6 // The job list of --batch cannot be read
+#define ERROR_BATCH_FAILED      7 // At least one job of --batch failed
+#define ERROR_DAEMON_SOCKET     8 // The socket of --daemon cannot be opened
 
 // Structure to store program input parameters
 typedef struct {
@@ -22,6 +27,42 @@ typedef struct {
     double y_max;              // Upper bound for y
 } input_params_t;
 
+// Command line options, accepted anywhere among the positional arguments
+typedef struct {
+    bool use_jit;              // Evaluate with native code instead of the interpreter
+    int  num_threads;          // Sampling threads, 1 by default
+    double tolerance;          // Adaptive sampling tolerance in device units, 0 for the fixed grid
+    bool   cull;               // Skip ranges proven invisible by interval arithmetic, on by default
+    double decimate_columns;   // Columns per device unit for min/max decimation, 0 keeps all points
+    double simplify_tolerance; // Polyline simplification tolerance in device units, 0 keeps all points
+    ps_path_encoding_t path_encoding; // Encoding of the function path in the PostScript file
+    double grid_units;         // Device grid of the compact encodings in steps per point, 0 for the default
+    bool   async_export;       // Format and write the file on a separate thread
+    const char* batch_path;    // Job list of --batch, "-" for standard input, NULL for a single plot
+    int    num_workers;        // Jobs of --batch rendered at once, 1 by default
+    const char* daemon_path;   // Socket of --daemon, NULL for a single plot
+    int    cache_entries;      // Compiled expressions kept by --daemon
+    const char* render_cache_dir; // Directory of rendered files reused across runs, NULL for none
+    int    render_cache_mb;    // Size bound of that directory in megabytes
+    stats_format_t stats_format; // Report of stage timings and counters, STATS_OFF by default
+    bool   profile_eval;       // Attribute the evaluation time to the subterms of the function
+    const char* trace_path;    // Chrome trace-event file written at exit, NULL for none
+} program_options_t;
+
+/**
+ * @brief Extracts the recognized --options from the command line.
+ *
+ * @param options Pointer to program_options_t structure to fill
+ * @param argc Argument count
+ * @param argv Argument vector, the options are removed from it
+ * @return int Count of the remaining arguments, including the program name,
+ *             or -1 if an option has an invalid value.
+ *
+ * Unrecognized arguments are kept as positional ones, so expressions
+ * such as "--x" still reach the function parser.
+ */
+int extract_options(program_options_t* options, int argc, char* argv[]);
+
 // Function prototypes
 bool check_arg_count(int argc);
 input_params_t* allocate_params();
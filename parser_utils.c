@@ -2,8 +2,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <ctype.h>
 #include "parser_utils.h"
 #include "defs.h"
+#include "function_registry.h"
 
 // Helper Function to Remove Trailing Zeros from Fractional Part
 void remove_trailing_zeros(char* num_str) {
@@ -58,18 +60,19 @@ bool is_valid_filename(const char* filename) {
 char* extract_output_file(const char* output_file_str) {
     // Check if the output file string is NULL or empty
     if (output_file_str == NULL || strlen(output_file_str) == 0) {
-        printf("[DEBUG]: Output file string is NULL or empty.\n");
+        DEBUG_PRINTF("[DEBUG]: Output file string is NULL or empty.\n");
         return NULL;
     }
 
     // Validate the filename
     if (!is_valid_filename(output_file_str)) {
-        printf("[DEBUG]: Output file name contains invalid characters: %s\n", output_file_str);
+        DEBUG_PRINTF("[DEBUG]: Output file name contains invalid characters: %s\n", output_file_str);
         return NULL;
     }
 
-    // Attempt to open the file for writing to verify creation and write permissions
-    FILE* file = fopen(output_file_str, "w");
+    // Attempt to open the file for writing to verify creation and write permissions,
+    // appending leaves the content alone in case another job is writing it
+    FILE* file = fopen(output_file_str, "a");
     if (file == NULL) {
         perror("[DEBUG]: Failed to create or open the output file");  // Use perror for more detailed error
         return NULL;
@@ -81,7 +84,7 @@ char* extract_output_file(const char* output_file_str) {
     // Duplicate the file string to store in params
     char* output_file_copy = strdup(output_file_str);
     if (output_file_copy == NULL) {
-        printf("[DEBUG]: Memory allocation error for output_file_copy.\n");
+        DEBUG_PRINTF("[DEBUG]: Memory allocation error for output_file_copy.\n");
         return NULL;
     }
 
@@ -98,34 +101,35 @@ bool parse_limits(const char* limits_str, double* x_min, double* x_max, double*
         return false;
     }
 
+    // strtok_r keeps its position in save, so parallel jobs do not share it
     char* token;
-    char* rest = limits_copy;
+    char* save = NULL;
 
-    token = strtok(rest, DELIMITER);
+    token = strtok_r(limits_copy, DELIMITER, &save);
     if (token == NULL || sscanf(token, "%lf", x_min) != 1) {
         free(limits_copy);
         return false;
     }
 
-    token = strtok(NULL, DELIMITER);
+    token = strtok_r(NULL, DELIMITER, &save);
     if (token == NULL || sscanf(token, "%lf", x_max) != 1) {
         free(limits_copy);
         return false;
     }
 
-    token = strtok(NULL, DELIMITER);
+    token = strtok_r(NULL, DELIMITER, &save);
     if (token == NULL || sscanf(token, "%lf", y_min) != 1) {
         free(limits_copy);
         return false;
     }
 
-    token = strtok(NULL, DELIMITER);
+    token = strtok_r(NULL, DELIMITER, &save);
     if (token == NULL || sscanf(token, "%lf", y_max) != 1) {
         free(limits_copy);
         return false;
     }
 
-    if (strtok(NULL, DELIMITER) != NULL) {
+    if (strtok_r(NULL, DELIMITER, &save) != NULL) {
         free(limits_copy);
         return false;
     }
@@ -137,7 +141,7 @@ bool parse_limits(const char* limits_str, double* x_min, double* x_max, double*
 // Function to set default limits
 void set_default_limits(input_params_t* params) {
     if (params) {
-        printf("[DEBUG]: Setting default limits\n");
+        DEBUG_PRINTF("[DEBUG]: Setting default limits\n");
         params->x_min = DEFAULT_MIN;
         params->x_max = DEFAULT_MAX;
         params->y_min = DEFAULT_MIN;
@@ -146,17 +150,52 @@ void set_default_limits(input_params_t* params) {
     }
 }
 
+int split_arguments(char* line, char** arguments, int max_arguments) {
+    int count = 0;
+    char* in = line;
+
+    for (;;) {
+        while (isspace((unsigned char)*in)) {
+            in++;
+        }
+        if (*in == END_STRING_CHAR) {
+            return count;
+        }
+        if (count == max_arguments) {
+            return -1;
+        }
+
+        // The argument is copied over itself without its quotes
+        char* out = in;
+        arguments[count++] = out;
+        char quote = END_STRING_CHAR;
+        while (*in != END_STRING_CHAR && (quote != END_STRING_CHAR || !isspace((unsigned char)*in))) {
+            if (quote == END_STRING_CHAR && (*in == '"' || *in == '\'')) {
+                quote = *in++;
+            } else if (*in == quote) {
+                quote = END_STRING_CHAR;
+                in++;
+            } else {
+                *out++ = *in++;
+            }
+        }
+        if (quote != END_STRING_CHAR) {
+            return -1;
+        }
+        if (*in != END_STRING_CHAR) {
+            in++;
+        }
+        *out = END_STRING_CHAR;
+    }
+}
+
 // Check if a string is a supported function
 bool is_supported_function(const char* func) {
     if (func == NULL) {
         return false;
     }
 
-    return strcmp(func, FUNC_ABS)  == 0 || strcmp(func, FUNC_EXP)  == 0 || strcmp(func, FUNC_LN)   == 0 ||
-           strcmp(func, FUNC_LOG)  == 0 || strcmp(func, FUNC_SIN)  == 0 || strcmp(func, FUNC_COS)  == 0 ||
-           strcmp(func, FUNC_TAN)  == 0 || strcmp(func, FUNC_ASIN) == 0 || strcmp(func, FUNC_ACOS) == 0 ||
-           strcmp(func, FUNC_ATAN) == 0 || strcmp(func, FUNC_SINH) == 0 || strcmp(func, FUNC_COSH) == 0 ||
-           strcmp(func, FUNC_TANH) == 0;
+    return find_function(func) >= 0;
 }
 
 
@@ -44,6 +44,18 @@ bool parse_limits(const char* limits_str, double *x_min, double *x_max, double *
 
 void set_default_limits(input_params_t* params);
 
+/**
+ * @brief Splits a line in place into blank-separated arguments.
+ *
+ * @param line Line to split, its characters are overwritten
+ * @param arguments Receives pointers into the line
+ * @param max_arguments Size of the arguments array
+ * @return int Number of arguments, -1 if there are more than max_arguments or a quote is not closed.
+ *
+ * Single or double quotes group blanks into one argument and are removed.
+ */
+int split_arguments(char* line, char** arguments, int max_arguments);
+
 // Check if a string is a supported function
 bool is_supported_function(const char* func);
 
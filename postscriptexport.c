@@ -1,5 +1,6 @@
 #include "postscriptexport.h"
 #include "defs.h"
+#include "trace.h"
 
 // Function to find minimum and maximum in array
 void find_min_max(const double *arr, int num_points, double *min, double *max) {
@@ -14,24 +15,243 @@ void find_min_max(const double *arr, int num_points, double *min, double *max) {
     }
 }
 
-// Main export function to create a PostScript file
-void export_to_postscript(const char* filename, const double *x_values, const double *y_values, int num_points,
-                          double x_min, double x_max, double y_min, double y_max,
-                          const char* function_label, const char* interval_label) {
-    if (filename == NULL || x_values == NULL || y_values == NULL || num_points < 0 ||
-        function_label == NULL || interval_label == NULL) {
-        fprintf(stderr, "Error: Invalid arguments in export_to_postscript\n");
+static void init_path_encoder(ps_path_encoder_t* encoder, ps_writer_t* writer,
+                              double units_x, double units_y, bool arrays) {
+    memset(encoder, 0, sizeof(ps_path_encoder_t));
+    encoder->writer  = writer;
+    encoder->units_x = units_x;
+    encoder->units_y = units_y;
+    encoder->arrays  = arrays;
+}
+
+// Writing the steps waiting for their array, a single one without an array
+static void flush_encoder_steps(ps_path_encoder_t* encoder) {
+    ps_writer_t* writer = encoder->writer;
+    const long long* steps = encoder->steps;
+    int num_steps = encoder->num_steps;
+
+    if (num_steps == 1) {
+        ps_write_integer(writer, steps[0]);
+        ps_write_bytes(writer, " ", 1);
+        ps_write_integer(writer, steps[1]);
+        ps_write_bytes(writer, " r\n", 3);
+    } else if (num_steps > 1) {
+        ps_write_bytes(writer, "[", 1);
+        for (int k = num_steps - 1; k >= 0; k--) {
+            ps_write_integer(writer, steps[2 * k]);
+            ps_write_bytes(writer, " ", 1);
+            ps_write_integer(writer, steps[2 * k + 1]);
+            if (k > 0) {
+                bool line_end = (num_steps - k) % PS_COMPACT_LINE_SEGMENTS == 0;
+                ps_write_bytes(writer, line_end ? "\n" : " ", 1);
+            }
+        }
+        ps_write_bytes(writer, "] p\n", 4);
+    }
+    encoder->num_steps = 0;
+}
+
+// Writing the held step, preceded by the move to the subpath start if that is still pending
+static void emit_encoder_step(ps_path_encoder_t* encoder) {
+    if (!encoder->has_step) {
+        return;
+    }
+    ps_writer_t* writer = encoder->writer;
+
+    if (encoder->move_pending) {
+        flush_encoder_steps(encoder);
+        ps_write_integer(writer, encoder->start_x);
+        ps_write_bytes(writer, " ", 1);
+        ps_write_integer(writer, encoder->start_y);
+        ps_write_bytes(writer, " m\n", 3);
+        encoder->move_pending = false;
+        encoder->moves++;
+    }
+    if (encoder->arrays) {
+        encoder->steps[2 * encoder->num_steps]     = encoder->step_x;
+        encoder->steps[2 * encoder->num_steps + 1] = encoder->step_y;
+        if (++encoder->num_steps == PS_COMPACT_ARRAY_SEGMENTS) {
+            flush_encoder_steps(encoder);
+        }
+    } else {
+        ps_write_integer(writer, encoder->step_x);
+        ps_write_bytes(writer, " ", 1);
+        ps_write_integer(writer, encoder->step_y);
+        ps_write_bytes(writer, " r\n", 3);
+    }
+    encoder->has_step = false;
+}
+
+// Adding a point: a subpath starts where pen_down is false, otherwise the pen draws to it.
+// Points are rounded to the grid first, so rounding errors do not add up along the path.
+static void encode_path_point(ps_path_encoder_t* encoder, double x, double y, bool pen_down) {
+    long long grid_x = llround(x * encoder->units_x);
+    long long grid_y = llround(y * encoder->units_y);
+
+    if (!pen_down) {
+        emit_encoder_step(encoder);
+        if (encoder->move_pending) {
+            encoder->removed++; // the previous subpath never drew anything
+        }
+        encoder->move_pending = true;
+        encoder->start_x = encoder->grid_x = grid_x;
+        encoder->start_y = encoder->grid_y = grid_y;
+        return;
+    }
+
+    long long step_x = grid_x - encoder->grid_x;
+    long long step_y = grid_y - encoder->grid_y;
+    if (step_x == 0 && step_y == 0) {
+        encoder->removed++;
+        return;
+    }
+    encoder->grid_x = grid_x;
+    encoder->grid_y = grid_y;
+
+    // Exactly collinear and in the same direction on the grid: the point between is dropped
+    if (encoder->has_step && encoder->step_x * step_y == encoder->step_y * step_x &&
+        encoder->step_x * step_x + encoder->step_y * step_y > 0) {
+        encoder->step_x += step_x;
+        encoder->step_y += step_y;
+        encoder->removed++;
+        return;
+    }
+    emit_encoder_step(encoder);
+    encoder->step_x   = step_x;
+    encoder->step_y   = step_y;
+    encoder->has_step = true;
+}
+
+// Writing what is held back, returning the number of dropped points
+static long long finish_path_encoder(ps_path_encoder_t* encoder) {
+    emit_encoder_step(encoder);
+    flush_encoder_steps(encoder);
+    if (encoder->move_pending) {
+        encoder->removed++;
+        encoder->move_pending = false;
+    }
+    return encoder->removed;
+}
+
+// Writing one point of the path in the chosen encoding
+static void write_path_point(ps_export_t* export, double x, double y, bool pen_down) {
+    export->written++;
+    if (export->options.encoding == PS_PATH_ABSOLUTE) {
+        export->moves += !pen_down;
+        ps_write_fixed2(&export->writer, x);
+        ps_write_bytes(&export->writer, " ", 1);
+        ps_write_fixed2(&export->writer, y * export->xy_scale);
+        ps_write_bytes(&export->writer, pen_down ? " lineto\n" : " moveto\n", 8);
+    } else {
+        encode_path_point(&export->encoder, x, y, pen_down);
+    }
+}
+
+// Passing the previous point on, if it was not already
+static void keep_previous_point(ps_export_t* export) {
+    ps_simplifier_t* simplifier = &export->simplifier;
+    if (!simplifier->previous_kept) {
+        write_path_point(export, simplifier->previous_x, simplifier->previous_y, true);
+        simplifier->previous_kept = true;
+    }
+}
+
+// Simplifying by sleeve fitting: from the anchor, the directions that pass within the
+// tolerance of every following point form a narrowing cone, and the previous point is
+// kept when the next one falls outside it
+static void simplify_path_point(ps_export_t* export, double x, double y, bool pen_down) {
+    ps_simplifier_t* simplifier = &export->simplifier;
+    double tolerance = export->options.simplify_tolerance;
+
+    if (!pen_down) {
+        // A new subpath: keep the end of the previous one and restart here
+        keep_previous_point(export);
+        write_path_point(export, x, y, false);
+        simplifier->anchor_x = x;
+        simplifier->anchor_y = y;
+        simplifier->has_direction = false;
+        simplifier->previous_x = x;
+        simplifier->previous_y = y;
+        simplifier->previous_kept = true;
         return;
     }
 
+    for (;;) {
+        double dx = (x - simplifier->anchor_x) * simplifier->scale_x;
+        double dy = (y - simplifier->anchor_y) * simplifier->scale_y;
+        double distance = hypot(dx, dy);
+        if (distance <= tolerance) {
+            break; // close to the anchor, any direction passes
+        }
+
+        double angle = atan2(dy, dx);
+        double spread = asin(tolerance / distance);
+        if (!simplifier->has_direction) {
+            simplifier->base_angle = angle;
+            simplifier->low  = -spread;
+            simplifier->high = spread;
+            simplifier->has_direction = true;
+            break;
+        }
+
+        double relative = remainder(angle - simplifier->base_angle, 2 * M_PI);
+        if (relative < simplifier->low || relative > simplifier->high) {
+            // Outside the cone: the previous point becomes the anchor, and this one is looked at again
+            keep_previous_point(export);
+            simplifier->anchor_x = simplifier->previous_x;
+            simplifier->anchor_y = simplifier->previous_y;
+            simplifier->has_direction = false;
+            continue;
+        }
+        simplifier->low  = fmax(simplifier->low, relative - spread);
+        simplifier->high = fmin(simplifier->high, relative + spread);
+        break;
+    }
+    simplifier->previous_x = x;
+    simplifier->previous_y = y;
+    simplifier->previous_kept = false;
+}
+
+void init_postscript_export(ps_export_t* export) {
+    if (export != NULL) {
+        memset(export, 0, sizeof(ps_export_t));
+    }
+}
+
+void free_postscript_export(ps_export_t* export) {
+    if (export != NULL) {
+        ps_writer_close(&export->writer);
+    }
+}
+
+bool begin_postscript_export(ps_export_t* export, const char* filename,
+                             double x_min, double x_max, double y_min, double y_max,
+                             const char* function_label, const char* interval_label,
+                             const ps_export_options_t* options) {
+    if (export == NULL || filename == NULL || function_label == NULL || interval_label == NULL) {
+        fprintf(stderr, "Error: Invalid arguments in begin_postscript_export\n");
+        return false;
+    }
+
+    // The writer buffer of a previous export is reused
+    ps_writer_t writer = export->writer;
+    memset(export, 0, sizeof(ps_export_t));
+    export->writer = writer;
+    if (options != NULL) {
+        export->options = *options;
+    }
+    export->filename = filename;
+
     FILE *file = fopen(filename, "w");
     if (!file) {
         perror("Error opening file");
-        return;
+        return false;
     }
+    export->file = file;
 
     // Calculating the scale to maintain the graph's proportions
     double xy_scale = (x_max - x_min) / (y_max - y_min);
+    export->xy_scale = xy_scale;
 
     // Calculate font size and line thickness based on axis range
     double axis_range = fmax(x_max - x_min, (y_max - y_min) * xy_scale);
@@ -52,22 +272,295 @@ void export_to_postscript(const char* filename, const double *x_values, const do
     draw_labels(file, x_min, x_max, y_min, y_max, font_size, xy_scale);
     draw_function_text(file, function_label, interval_label, x_min, x_max, y_max, xy_scale, font_size);
 
+    export->simplifier.scale_x = scale_ps_x;
+    export->simplifier.scale_y = scale_ps_y * xy_scale;
+    export->simplifier.previous_kept = true; // there is no previous point yet
+
     // Drawing a function graph
     fprintf(file, "0 0 1 setrgbcolor\n"); 
     fprintf(file, "newpath\n");
-    fprintf(file, "%.2f %.2f moveto\n", x_values[0], y_values[0] * xy_scale);
-    for (int i = 1; i < num_points; i++) {
-        if (fabs(x_values[i] - x_values[i - 1] - X_STEP_VALUE) < ABOUT_ZERO_CONST) {
-            fprintf(file, "%.2f %.2f lineto\n", x_values[i], y_values[i] * xy_scale);
+    if (export->options.encoding != PS_PATH_ABSOLUTE) {
+        // Grid steps become user units through the matrix, it is restored before stroke,
+        // so the line width stays the same
+        double grid = export->options.grid_units > 0 ? export->options.grid_units : PS_COMPACT_UNITS_PER_POINT;
+        export->options.grid_units = grid;
+        double units_x = grid * scale_ps_x;
+        double units_y = grid * scale_ps_y;
+        fprintf(file, "/pathmatrix matrix currentmatrix def\n");
+        fprintf(file, "/r {rlineto} bind def\n");
+        if (export->options.encoding == PS_PATH_ARRAYS) {
+            // The last pair of an array is on top after aload, so pairs are stored backwards
+            fprintf(file, "/p {aload length 2 idiv {rlineto} repeat} bind def\n");
+        }
+        fprintf(file, "%.9g %.9g scale\n", 1 / units_x, 1 / units_y);
+        init_path_encoder(&export->encoder, &export->writer, units_x, units_y * xy_scale,
+                          export->options.encoding == PS_PATH_ARRAYS);
+    }
+
+    // The writer appends through fwrite, after what fprintf has buffered so far
+    if (export->writer.buffer != NULL) {
+        ps_writer_reset(&export->writer, file);
+    } else if (!ps_writer_init(&export->writer, file, PS_WRITER_BUFFER_SIZE)) {
+        fprintf(stderr, "Error: Memory allocation failed in begin_postscript_export\n");
+        fclose(file);
+        export->file = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool export_path_points(ps_export_t* export, const double* x_values, const double* y_values,
+                        const bool* connected, int count) {
+    if (export == NULL || export->file == NULL || x_values == NULL || y_values == NULL || count < 0) {
+        return false;
+    }
+
+    unsigned long long span = begin_trace_span();
+    for (int i = 0; i < count; i++) {
+        // Pen lifts, from the sampler or from gaps in x; the first point always starts a subpath
+        bool pen_down = export->points > 0 &&
+                        (connected != NULL ? connected[i]
+                                           : fabs(x_values[i] - export->last_x - X_STEP_VALUE) < ABOUT_ZERO_CONST);
+        export->last_x = x_values[i];
+        export->points++;
+
+        if (export->options.simplify_tolerance > 0) {
+            simplify_path_point(export, x_values[i], y_values[i], pen_down);
         } else {
-            fprintf(file, "%.2f %.2f moveto\n", x_values[i], y_values[i] * xy_scale);
+            write_path_point(export, x_values[i], y_values[i], pen_down);
+        }
+    }
+    end_trace_span("export_path_points", span, "points", count);
+    return !export->writer.failed;
+}
+
+bool end_postscript_export(ps_export_t* export) {
+    if (export == NULL || export->file == NULL) {
+        return false;
+    }
+
+    if (export->options.simplify_tolerance > 0) {
+        keep_previous_point(export);
+        DEBUG_PRINTF("[DEBUG]: Simplification kept %lld of %lld points\n", export->written, export->points);
+    }
+    // Every written point is a moveto or a lineto, unless the compact encoding dropped it
+    long long removed = 0;
+    if (export->options.encoding != PS_PATH_ABSOLUTE) {
+        removed = finish_path_encoder(&export->encoder);
+        export->moves = export->encoder.moves;
+        DEBUG_PRINTF("[DEBUG]: Quantization to 1/%g point removed %lld of %lld points\n",
+               export->options.grid_units, removed, export->written);
+    }
+    export->lines = export->written - removed - export->moves;
+
+    bool success = ps_writer_flush(&export->writer);
+    if (!success) {
+        fprintf(stderr, "Error: Writing the path to '%s' failed\n", export->filename);
+    }
+    if (export->options.encoding != PS_PATH_ABSOLUTE) {
+        fprintf(export->file, "pathmatrix setmatrix\n");
+    }
+    fprintf(export->file, "stroke\n");
+
+    write_postscript_trailer(export->file); // File End Recording
+    export->bytes = ftell(export->file);
+    if (fclose(export->file) != 0) {
+        success = false;
+    }
+    export->file = NULL;
+    return success;
+}
+
+// Main export function to create a PostScript file
+void export_to_postscript(const char* filename, const double *x_values, const double *y_values,
+                          const bool *connected, int num_points,
+                          double x_min, double x_max, double y_min, double y_max,
+                          const char* function_label, const char* interval_label,
+                          const ps_export_options_t* options) {
+    if (filename == NULL || x_values == NULL || y_values == NULL || num_points < 0 ||
+        function_label == NULL || interval_label == NULL) {
+        fprintf(stderr, "Error: Invalid arguments in export_to_postscript\n");
+        return;
+    }
+
+    ps_export_t export;
+    init_postscript_export(&export);
+    if (begin_postscript_export(&export, filename, x_min, x_max, y_min, y_max,
+                                function_label, interval_label, options)) {
+        export_path_points(&export, x_values, y_values, connected, num_points);
+        if (end_postscript_export(&export)) {
+            DEBUG_PRINTF("PostScript файл '%s' успешно создан.\n", filename);
+        }
+    }
+    free_postscript_export(&export);
+}
+
+int format_fixed2(double value, char* out) {
+    double magnitude = fabs(value);
+    if (!(magnitude < 1e13)) {
+        return snprintf(out, FIXED2_MAX_LENGTH, "%.2f", value);
+    }
+
+    // Hundredths, rounded half to even on the exact value of magnitude * 100
+    long long hundredths = 0;
+    if (magnitude >= 0.004) {
+        double product = magnitude * 100;
+        double rounded = nearbyint(product);
+        double fraction = product - rounded; // exact, in [-0.5, 0.5]
+        hundredths = (long long)rounded;
+
+        // Near a midpoint the rounding error of the product decides
+        if (fabs(fraction) > 0.4375) {
+            double error = fma(magnitude, 100, -product); // product + error is exact
+            double above = fraction > 0 ? (fraction - 0.5) + error : (fraction + 0.5) + error;
+            if (fraction > 0 && (above > 0 || (above == 0 && (hundredths & 1)))) {
+                hundredths++;
+            } else if (fraction < 0 && (above < 0 || (above == 0 && (hundredths & 1)))) {
+                hundredths--;
+            }
+        }
+    }
+
+    // Digits backwards, then reversed into place
+    char digits[24];
+    int count = 0;
+    long long rest = hundredths;
+    do {
+        digits[count++] = (char)('0' + rest % 10);
+        rest /= 10;
+        if (count == 2) {
+            digits[count++] = '.';
+        }
+    } while (rest > 0 || count < 4);
+
+    int length = 0;
+    if (signbit(value)) {
+        out[length++] = '-';
+    }
+    while (count > 0) {
+        out[length++] = digits[--count];
+    }
+    return length;
+}
+
+bool ps_writer_init(ps_writer_t* writer, FILE* file, size_t capacity) {
+    if (writer == NULL || file == NULL || capacity < 64) {
+        return false;
+    }
+
+    memset(writer, 0, sizeof(ps_writer_t));
+    writer->file = file;
+    writer->buffer = (char*)malloc(capacity);
+    if (writer->buffer == NULL) {
+        writer->failed = true;
+        return false;
+    }
+    writer->capacity = capacity;
+    return true;
+}
+
+void ps_writer_reset(ps_writer_t* writer, FILE* file) {
+    if (writer != NULL) {
+        writer->file    = file;
+        writer->length  = 0;
+        writer->written = 0;
+        writer->failed  = writer->buffer == NULL;
+    }
+}
+
+bool ps_writer_flush(ps_writer_t* writer) {
+    if (writer == NULL || writer->buffer == NULL) {
+        return false;
+    }
+    if (writer->length > 0) {
+        unsigned long long span = begin_trace_span();
+        if (fwrite(writer->buffer, 1, writer->length, writer->file) != writer->length) {
+            writer->failed = true;
+        }
+        end_trace_span("ps_writer_flush", span, "bytes", (long long)writer->length);
+        writer->written += writer->length;
+        writer->length = 0;
+    }
+    return !writer->failed;
+}
+
+// Making room for n more bytes
+static inline bool ps_writer_reserve(ps_writer_t* writer, size_t n) {
+    if (writer->buffer == NULL) {
+        return false;
+    }
+    if (writer->capacity - writer->length < n) {
+        ps_writer_flush(writer);
+    }
+    return writer->capacity - writer->length >= n;
+}
+
+void ps_write_bytes(ps_writer_t* writer, const char* data, size_t n) {
+    if (writer == NULL || data == NULL) {
+        return;
+    }
+
+    if (n > writer->capacity) {
+        ps_writer_flush(writer);
+        if (fwrite(data, 1, n, writer->file) != n) {
+            writer->failed = true;
         }
+        writer->written += n;
+        return;
+    }
+    if (ps_writer_reserve(writer, n)) {
+        memcpy(writer->buffer + writer->length, data, n);
+        writer->length += n;
+    }
+}
+
+void ps_write_string(ps_writer_t* writer, const char* str) {
+    if (str != NULL) {
+        ps_write_bytes(writer, str, strlen(str));
+    }
+}
+
+void ps_write_fixed2(ps_writer_t* writer, double value) {
+    if (writer == NULL || !ps_writer_reserve(writer, FIXED2_MAX_LENGTH)) {
+        return;
+    }
+    writer->length += format_fixed2(value, writer->buffer + writer->length);
+}
+
+void ps_write_integer(ps_writer_t* writer, long long value) {
+    if (writer == NULL || !ps_writer_reserve(writer, 24)) {
+        return;
+    }
+
+    // Digits backwards, then reversed into place
+    char digits[24];
+    int count = 0;
+    unsigned long long rest = value < 0 ? 0 - (unsigned long long)value : (unsigned long long)value;
+    do {
+        digits[count++] = (char)('0' + rest % 10);
+        rest /= 10;
+    } while (rest > 0);
+
+    char* out = writer->buffer + writer->length;
+    int length = 0;
+    if (value < 0) {
+        out[length++] = '-';
+    }
+    while (count > 0) {
+        out[length++] = digits[--count];
+    }
+    writer->length += length;
+}
+
+bool ps_writer_close(ps_writer_t* writer) {
+    if (writer == NULL) {
+        return false;
     }
-    fprintf(file, "stroke\n");
 
-    write_postscript_trailer(file); // File End Recording
-    fclose(file);
-    printf("PostScript файл '%s' успешно создан.\n", filename);
+    bool success = writer->buffer != NULL && ps_writer_flush(writer);
+    free(writer->buffer);
+    writer->buffer = NULL;
+    return success;
 }
 
 // Function for writing the header of a PostScript file
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <stdbool.h>
 
 // Constants for graph settings
 #define POSTSCRIPT_WIDTH 600
@@ -15,15 +16,187 @@
 #define LINE_WIDTH_DIVISOR 300
 #define FONT_SIZE_CONST 8
 
+// Default simplification tolerance in device units (points)
+#define SIMPLIFY_TOLERANCE 0.1
 
+// Size of the in-memory buffer of the path writer
+#define PS_WRITER_BUFFER_SIZE (256 * 1024)
+
+// Longest "%.2f" of a double with its terminator: sign, 309 digits, point and 2 decimals
+#define FIXED2_MAX_LENGTH 320
+
+// Grid of the compact path encoding, in steps per device unit (point)
+#define PS_COMPACT_UNITS_PER_POINT 16
+// Finest grid accepted by --quantize
+#define PS_COMPACT_MAX_UNITS_PER_POINT 1024
+// Segments per packed array: the array and its unpacked values stay within
+// the 500 entries of a Level 1 operand stack
+#define PS_COMPACT_ARRAY_SEGMENTS 200
+// Segments per line of a packed array, keeping lines short
+#define PS_COMPACT_LINE_SEGMENTS 12
+
+// Buffered writer for the path, formats numbers without printf
+typedef struct {
+    FILE*  file;
+    char*  buffer;
+    size_t length;    // bytes waiting in the buffer
+    size_t capacity;
+    size_t written;   // bytes handed to the file so far
+    bool   failed;    // an allocation or write failed
+} ps_writer_t;
+
+// Creating a writer on an open file, the buffer is allocated here
+bool ps_writer_init(ps_writer_t* writer, FILE* file, size_t capacity);
+
+// Pointing a writer at another file, the buffer is kept
+void ps_writer_reset(ps_writer_t* writer, FILE* file);
+
+// Appending n bytes, or a string
+void ps_write_bytes(ps_writer_t* writer, const char* data, size_t n);
+void ps_write_string(ps_writer_t* writer, const char* str);
+
+// Appending a number exactly as printf("%.2f") would
+void ps_write_fixed2(ps_writer_t* writer, double value);
+
+// Appending an integer in decimal
+void ps_write_integer(ps_writer_t* writer, long long value);
+
+// Handing the buffered bytes to the file
+bool ps_writer_flush(ps_writer_t* writer);
+
+// Flushing and releasing the buffer, the file stays open
+bool ps_writer_close(ps_writer_t* writer);
+
+/**
+ * @brief Formats a number like printf("%.2f"), without printf.
+ *
+ * @param value Number to format
+ * @param out Buffer with room for at least FIXED2_MAX_LENGTH characters
+ * @return int Number of characters written, without a terminator.
+ *
+ * Rounds the exact binary value half to even, as glibc does, so the output
+ * is byte-identical to printf. Values of 1e13 and above, infinities and NaN
+ * fall back to snprintf.
+ */
+int format_fixed2(double value, char* out);
+
+// Encoding of the function path
+typedef enum {
+    PS_PATH_ABSOLUTE,  // "x y lineto" in user space with two decimals
+    PS_PATH_RELATIVE,  // integer steps on the device grid, "dx dy r"
+    PS_PATH_ARRAYS     // the same steps packed into arrays, "[...] p"
+} ps_path_encoding_t;
+
+// Optional stages of the export
+typedef struct {
+    double simplify_tolerance;   // Drop points closer than this to the simplified path, 0 keeps all
+    ps_path_encoding_t encoding; // PS_PATH_ABSOLUTE keeps the classic output
+    double grid_units;           // Grid steps per point of the compact encodings, 0 for the default
+} ps_export_options_t;
+
+
+// Encoder of the compact path, fed one point at a time
+typedef struct {
+    ps_writer_t* writer;
+    double    units_x;       // grid steps per user unit
+    double    units_y;
+    bool      arrays;        // pack steps into arrays
+    long long steps[2 * PS_COMPACT_ARRAY_SEGMENTS];
+    int       num_steps;     // steps waiting for their array
+    bool      move_pending;  // the subpath start is not written until it gets a segment
+    long long start_x;
+    long long start_y;
+    long long grid_x;        // grid position at the end of the held step
+    long long grid_y;
+    long long step_x;        // step held back, collinear followers are merged into it
+    long long step_y;
+    bool      has_step;
+    long long removed;       // points dropped as duplicates, collinear or lone moves
+    long long moves;         // subpath starts written
+} ps_path_encoder_t;
+
+/*
+ * State of the path simplification, in device space. Sleeve fitting in one
+ * O(n) pass: from the last kept point, the directions that pass within the
+ * tolerance of every following point form a narrowing cone, and a point is
+ * kept when the next one falls outside it. The first and last point of
+ * every subpath are always kept, so pen lifts survive.
+ */
+typedef struct {
+    double scale_x;          // device units per user unit
+    double scale_y;
+    double anchor_x;         // last kept point
+    double anchor_y;
+    double previous_x;       // last point seen
+    double previous_y;
+    bool   previous_kept;
+    bool   has_direction;
+    double base_angle;       // cone of allowed directions, relative to base_angle
+    double low;
+    double high;
+} ps_simplifier_t;
+
+// PostScript file being written, the path arrives in batches
+typedef struct {
+    FILE*  file;
+    const char* filename;
+    ps_writer_t writer;
+    ps_export_options_t options;
+    double xy_scale;
+    double last_x;           // x of the previous point, for the gap heuristic
+    long long points;        // points received
+    long long written;       // points passed on to the path encoding
+    long long moves;         // moveto segments in the file, set by end_postscript_export()
+    long long lines;         // lineto segments in the file, likewise
+    long long bytes;         // size of the completed file, likewise
+    ps_simplifier_t   simplifier;
+    ps_path_encoder_t encoder;
+} ps_export_t;
 
 // Function to find minimum and maximum in array
 void find_min_max(const double* arr, int num_points, double* min, double* max);
 
-// Export function to create a PostScript file
-void export_to_postscript(const char* filename, const double *x_values, const double *y_values, int num_points,
+// Initializing an export state before its first use
+void init_postscript_export(ps_export_t* export);
+
+// Releasing the writer buffer kept by an export state
+void free_postscript_export(ps_export_t* export);
+
+/**
+ * @brief Opens the file and writes everything up to the function path.
+ *
+ * @param export Export state from init_postscript_export(), its writer buffer is reused
+ * @param filename Output file name, must stay valid until the end of the export
+ * @param options May be NULL for a plain export
+ * @return bool True on success, the file is closed again on failure.
+ *
+ * The path is then passed in by export_path_points() in any number of batches
+ * and the file is completed by end_postscript_export(), so the memory used
+ * does not depend on the number of points.
+ */
+bool begin_postscript_export(ps_export_t* export, const char* filename,
+                             double x_min, double x_max, double y_min, double y_max,
+                             const char* function_label, const char* interval_label,
+                             const ps_export_options_t* options);
+
+// Appending points in x order, connected[i] tells if point i continues the path
+// (NULL: points X_STEP_VALUE apart do); false once writing has failed
+bool export_path_points(ps_export_t* export, const double* x_values, const double* y_values,
+                        const bool* connected, int count);
+
+// Writing what is held back and the end of the file, false if any write failed
+bool end_postscript_export(ps_export_t* export);
+
+// Export function to create a PostScript file from points in memory,
+// connected[i] tells if point i continues the path (NULL: points X_STEP_VALUE apart do),
+// options may be NULL for a plain export. The compact encodings round the points to the
+// device grid and drop duplicates, points collinear with their neighbours on the grid and
+// subpaths that draw nothing.
+void export_to_postscript(const char* filename, const double *x_values, const double *y_values,
+                          const bool *connected, int num_points,
                           double x_min, double x_max, double y_min, double y_max,
-                          const char* function_label, const char* interval_label);
+                          const char* function_label, const char* interval_label,
+                          const ps_export_options_t* options);
 
 // Functions for writing parts of a PostScript file
 void write_postscript_header(FILE* file, float line_width, float font_size);
@@ -0,0 +1,484 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include "render.h"
+#include "defs.h"
+#include "shuntingyard.h"
+#include "bytecode.h"
+#include "optimizer.h"
+#include "jit.h"
+#include "decimation.h"
+#include "async_sink.h"
+#include "parser_utils.h"
+#include "timing.h"
+#include "eval_profile.h"
+#include "trace.h"
+
+// Sink passing sampled points to the PostScript export
+static bool export_batch(void* context, const double* x_values, const double* y_values,
+                         const bool* connected, int count) {
+    return export_path_points((ps_export_t*)context, x_values, y_values, connected, count);
+}
+
+// Sink passing sampled points to the decimation
+static bool decimate_batch(void* context, const double* x_values, const double* y_values,
+                           const bool* connected, int count) {
+    return decimate_points((decimator_t*)context, x_values, y_values, connected, count);
+}
+
+// Export sink with its time counted in the export stage, used only with --stats
+typedef struct {
+    ps_export_t* export;
+    double       wall; // seconds spent in the sink
+    double       cpu;  // CPU seconds of the thread running it
+} timed_export_t;
+
+static bool timed_export_batch(void* context, const double* x_values, const double* y_values,
+                               const bool* connected, int count) {
+    timed_export_t* timed = (timed_export_t*)context;
+    double wall = monotonic_seconds();
+    double cpu = thread_cpu_seconds();
+    bool ok = export_path_points(timed->export, x_values, y_values, connected, count);
+    timed->wall += monotonic_seconds() - wall;
+    timed->cpu  += thread_cpu_seconds() - cpu;
+    return ok;
+}
+
+void init_render_context(render_context_t* context) {
+    init_postscript_export(&context->export);
+    init_sample_buffer(&context->workspace);
+    context->cache = NULL;
+    memset(&context->disk_cache, 0, sizeof(context->disk_cache));
+    context->stats = NULL;
+    context->profile_output = NULL;
+}
+
+void free_render_context(render_context_t* context) {
+    free_postscript_export(&context->export);
+    free_sample_buffer(&context->workspace);
+}
+
+const char* render_status_text(int status) {
+    switch (status) {
+        case SUCCESS:                 return "ok";
+        case ERROR_ARG_COUNT:         return "wrong number of arguments";
+        case ERROR_INVALID_FUNCTION:  return "invalid function";
+        case ERROR_OUTPUT_FILE:       return "cannot write the output file";
+        case ERROR_INVALID_LIMITS:    return "invalid limits";
+        case ERROR_MEMORY_ALLOCATION: return "out of memory";
+        default:                      return "failed";
+    }
+}
+
+// Sampling the compiled expression into the file
+static int render_program(render_context_t* context, const program_options_t* options,
+                          const input_params_t* params, const ExpressionProgram* program, const JitProgram* jit) {
+    // Calculate the number of points based on x limits and X_STEP_VALUE, llround() is undefined past LLONG_MAX
+    double steps = (params->x_max - params->x_min) / X_STEP_VALUE;
+    if (!(steps < (double)LLONG_MAX) && options->tolerance <= 0) {
+        fprintf(stderr, "Error: The x range is too wide for a grid step of %g, use --adaptive\n", X_STEP_VALUE);
+        return ERROR_INVALID_LIMITS;
+    }
+    // Adaptive sampling does not walk the grid, the count only goes to the report
+    long long num_points = steps < (double)LLONG_MAX ? llround(steps) : LLONG_MAX;
+
+    char interval_label[100];  // Buffer for the interval string
+
+    // Generate the interval label using params min and max values
+    snprintf(interval_label, sizeof(interval_label), INTERVAL_STRING_FORMAT,
+             params->x_min, params->x_max, params->y_min, params->y_max);
+
+    render_stats_t* render_stats = context->stats;
+    stage_mark_t mark;
+    if (render_stats != NULL) {
+        begin_stage(&mark);
+    }
+
+    // The file is written while sampling, so memory does not grow with the range
+    ps_export_options_t export_options = {options->simplify_tolerance, options->path_encoding, options->grid_units};
+    ps_export_t* export = &context->export;
+    bool begun = begin_postscript_export(export, params->output_file_str, params->x_min, params->x_max,
+                                         params->y_min, params->y_max, params->function_str, interval_label,
+                                         &export_options);
+    if (render_stats != NULL) {
+        end_stage(render_stats, STAGE_EXPORT, &mark);
+        begin_stage(&mark);
+    }
+    if (!begun) {
+        return ERROR_OUTPUT_FILE;
+    }
+
+    // The profile counts the instructions of the interpreter, native code cannot be attributed
+    ExpressionProgram profiled;
+    ProgramProfile profile;
+    bool profiling = context->profile_output != NULL && init_program_profile(&profile, program);
+    if (profiling) {
+        profiled = *program;
+        profiled.profile = &profile;
+        program = &profiled;
+        if (jit != NULL) {
+            DEBUG_PRINTF("[DEBUG]: Profiling the interpreter instead of the native code\n");
+            jit = NULL;
+        }
+    }
+
+    // Sampled points go to the export, through the decimation and the writer thread if requested
+    sample_sink_t export_sink = export_batch;
+    void* export_context = export;
+    timed_export_t timed = {export, 0, 0};
+    if (render_stats != NULL) {
+        export_sink = timed_export_batch;
+        export_context = &timed;
+    }
+    sample_sink_t sink = export_sink;
+    void* sink_context = export_context;
+    async_sink_t async;
+    bool use_async = false;
+    if (options->async_export) {
+        use_async = start_async_sink(&async, export_sink, export_context);
+        if (use_async) {
+            sink = async_sink_push;
+            sink_context = &async;
+        } else {
+            DEBUG_PRINTF("[DEBUG]: Writer thread unavailable, writing on the sampling thread\n");
+        }
+    }
+    decimator_t decimator;
+    if (options->decimate_columns > 0) {
+        init_decimator(&decimator, params->x_min, params->x_max, options->decimate_columns, sink, sink_context);
+        sink = decimate_batch;
+        sink_context = &decimator;
+    }
+
+    // On the grid x = x_min + i*step keeps the chunks independent
+    sample_job_t job = {program, jit, params->x_min, params->x_max, X_STEP_VALUE,
+                        params->y_min, params->y_max, num_points, options->num_threads, options->tolerance,
+                        options->cull, &context->workspace};
+    sample_stats_t stats;
+    bool sampled = stream_samples(&job, sink, sink_context, &stats);
+    bool written = !stats.stopped;
+    if (sampled && options->decimate_columns > 0) {
+        written = finish_decimation(&decimator);
+    }
+    if (use_async) {
+        written = stop_async_sink(&async) && written;
+        DEBUG_PRINTF("[DEBUG]: Writer thread done, the sampler waited %lld times (slept %lld), "
+                     "the writer %lld times (slept %lld)\n",
+                     async.producer_waits, async.producer_parks, async.consumer_waits, async.consumer_parks);
+    }
+
+    if (options->cull) {
+        DEBUG_PRINTF("[DEBUG]: Interval test culled %lld samples\n", stats.culled);
+    }
+    if (options->tolerance > 0) {
+        DEBUG_PRINTF("[DEBUG]: Adaptive sampling evaluated %lld points instead of %lld, %lld visible\n",
+                     stats.evaluations, num_points, stats.kept);
+    } else {
+        DEBUG_PRINTF("[DEBUG]: Sampled %lld points on %d thread(s), %lld visible\n",
+                     num_points, options->num_threads, stats.kept);
+    }
+    if (options->decimate_columns > 0) {
+        DEBUG_PRINTF("[DEBUG]: Decimation kept %lld of %lld points\n", decimator.kept, stats.kept);
+    }
+
+    if (render_stats != NULL) {
+        // The export sink ran inside the sampling, on this thread unless the writer thread took it
+        end_stage(render_stats, STAGE_EVALUATION, &mark);
+        render_stats->stages[STAGE_EVALUATION].wall -= use_async ? 0 : timed.wall;
+        render_stats->stages[STAGE_EVALUATION].cpu  -= timed.cpu;
+        render_stats->stages[STAGE_EXPORT].wall     += timed.wall;
+        render_stats->stages[STAGE_EXPORT].cpu      += timed.cpu;
+        render_stats->evaluated = stats.evaluations;
+        render_stats->culled    = stats.culled;
+        render_stats->undefined = stats.undefined;
+        render_stats->kept      = stats.kept;
+        render_stats->decimated = options->decimate_columns > 0 ? decimator.kept : -1;
+        begin_stage(&mark);
+    }
+
+    // Completing the file even after a failure, so it is closed
+    written = end_postscript_export(export) && written;
+    if (render_stats != NULL) {
+        end_stage(render_stats, STAGE_EXPORT, &mark);
+        render_stats->written = export->written;
+        render_stats->moves   = export->moves;
+        render_stats->lines   = export->lines;
+        render_stats->bytes   = export->bytes;
+    }
+    if (profiling) {
+        print_program_profile(context->profile_output, program, &profile);
+        free_program_profile(&profile);
+    }
+
+    if (!sampled && written) {
+        perror("Failed to allocate memory");
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    if (!written) {
+        return ERROR_OUTPUT_FILE;
+    }
+    DEBUG_PRINTF("PostScript файл '%s' успешно создан.\n", params->output_file_str);
+    return SUCCESS;
+}
+
+// Parsing, optimizing and compiling the function
+static int compile_function(const char* function_str, ExpressionProgram* program, render_stats_t* stats) {
+    stage_mark_t mark;
+    if (stats != NULL) {
+        begin_stage(&mark);
+    }
+    unsigned long long span = begin_trace_span();
+    TokenQueue token_queue;
+    init_token_queue(&token_queue);
+    bool success = parse_expression(function_str, &token_queue);
+    end_trace_span("parse_expression", span, NULL, 0);
+    span = begin_trace_span();
+    if (stats != NULL) {
+        end_stage(stats, STAGE_PARSING, &mark);
+        begin_stage(&mark);
+    }
+    if (!success) {
+        DEBUG_PRINTF("Unsuccessful expression parsing!\n");
+        clear_token_queue(&token_queue);
+        return ERROR_INVALID_FUNCTION;
+    }
+
+    // Fold constants, simplify and reduce the strength of the expression
+    ExprNode* expression_tree = optimize_expression(&token_queue);
+    if (expression_tree == NULL) {
+        DEBUG_PRINTF("Unsuccessful expression optimization!\n");
+        clear_token_queue(&token_queue);
+        return ERROR_INVALID_FUNCTION;
+    }
+
+    // Compile the optimized expression into a flat program for the sampling loop
+    bool compiled = compile_expression_tree(expression_tree, program);
+    free_expression_tree(expression_tree);
+    clear_token_queue(&token_queue);
+    end_trace_span("compile_expression", span, "instructions", compiled ? (long long)program->length : 0);
+    if (stats != NULL) {
+        end_stage(stats, STAGE_COMPILATION, &mark);
+    }
+    if (!compiled) {
+        DEBUG_PRINTF("Unsuccessful expression compilation!\n");
+        return ERROR_INVALID_FUNCTION;
+    }
+    DEBUG_PRINTF("[DEBUG]: Compiled %zu instructions, %d shared subexpressions\n",
+                 program->length, program->num_slots);
+    return SUCCESS;
+}
+
+// Native code if requested, the interpreter stays the fallback
+static bool compile_native(const ExpressionProgram* program, JitProgram* jit, render_stats_t* stats) {
+    stage_mark_t mark;
+    if (stats != NULL) {
+        begin_stage(&mark);
+    }
+    unsigned long long span = begin_trace_span();
+    bool compiled = jit_compile(program, jit);
+    end_trace_span("jit_compile", span, NULL, 0);
+    if (stats != NULL) {
+        end_stage(stats, STAGE_COMPILATION, &mark);
+    }
+    if (compiled) {
+        DEBUG_PRINTF("[DEBUG]: JIT compiled the expression into %zu bytes\n", jit->size);
+    } else {
+        DEBUG_PRINTF("[DEBUG]: JIT unavailable, falling back to the interpreter\n");
+    }
+    return compiled;
+}
+
+// Rendering a function compiled once and kept in the cache of the context
+static int render_cached(render_context_t* context, const program_options_t* options, const input_params_t* params) {
+    cached_expression_t* entry = find_cached_expression(context->cache, params->function_str);
+    if (entry == NULL) {
+        ExpressionProgram program;
+        int status = compile_function(params->function_str, &program, context->stats);
+        if (status != SUCCESS) {
+            return status;
+        }
+        entry = insert_cached_expression(context->cache, params->function_str, &program);
+        if (entry == NULL) {
+            free_program(&program);
+            return ERROR_MEMORY_ALLOCATION;
+        }
+    } else {
+        DEBUG_PRINTF("[DEBUG]: Using the cached program of %s\n", params->function_str);
+    }
+
+    if (options->use_jit && !entry->has_jit && !entry->jit_failed) {
+        entry->has_jit = compile_native(&entry->program, &entry->jit, context->stats);
+        entry->jit_failed = !entry->has_jit;
+    }
+    return render_program(context, options, params, &entry->program,
+                          options->use_jit && entry->has_jit ? &entry->jit : NULL);
+}
+
+// Compiling the function, then rendering it
+static int render_params(render_context_t* context, const program_options_t* options, const input_params_t* params) {
+    if (context->cache != NULL) {
+        return render_cached(context, options, params);
+    }
+
+    ExpressionProgram program;
+    int status = compile_function(params->function_str, &program, context->stats);
+    if (status != SUCCESS) {
+        return status;
+    }
+
+    JitProgram jit;
+    bool use_jit = options->use_jit && compile_native(&program, &jit, context->stats);
+
+    status = render_program(context, options, params, &program, use_jit ? &jit : NULL);
+
+    // Cleanup
+    if (use_jit) {
+        jit_free(&jit);
+    }
+    free_program(&program);
+    return status;
+}
+
+// Stages of render_plot(), timed into context->stats when it is set
+static int render_input(render_context_t* context, const program_options_t* options,
+                        const char* function_arg, const char* output_arg, const char* limits_arg) {
+    render_stats_t* stats = context->stats;
+    stage_mark_t mark;
+    if (stats != NULL) {
+        begin_stage(&mark);
+    }
+    unsigned long long span = begin_trace_span();
+
+    // Allocate params
+    input_params_t* params = allocate_params();
+    if (!params) {
+        return ERROR_MEMORY_ALLOCATION;
+    }
+
+    // Extract function
+    if (!extract_function_param(params, function_arg)) {
+        free_input_params(params);
+        return ERROR_INVALID_FUNCTION;
+    }
+
+    // Extract output file
+    if (!extract_output_file_param(params, output_arg)) {
+        free_input_params(params);
+        return ERROR_OUTPUT_FILE;
+    }
+
+    // Parse limits if provided
+    if (limits_arg != NULL) {
+        if (!parse_limits_param(params, limits_arg)) {
+            free_input_params(params);
+            return ERROR_INVALID_LIMITS;
+        }
+    } else {
+        set_default_limits(params);
+    }
+    end_trace_span("extract_arguments", span, NULL, 0);
+    if (stats != NULL) {
+        end_stage(stats, STAGE_ARGUMENTS, &mark);
+        begin_stage(&mark);
+    }
+
+    // Normalize function
+    span = begin_trace_span();
+    bool normalized = normalize_function_param(params);
+    end_trace_span("normalize_function_param", span, NULL, 0);
+    if (!normalized) {
+        free_input_params(params);
+        return ERROR_INVALID_FUNCTION;
+    }
+
+    // Validate expression
+    span = begin_trace_span();
+    bool valid = validate_expression_param(params);
+    end_trace_span("validate_expression_param", span, NULL, 0);
+    if (!valid) {
+        free_input_params(params);
+        return ERROR_INVALID_FUNCTION;
+    }
+
+    // Check limits
+    if (!check_limits_valid(params)) {
+        free_input_params(params);
+        return ERROR_INVALID_LIMITS;
+    }
+    if (stats != NULL) {
+        end_stage(stats, STAGE_VALIDATION, &mark);
+    }
+
+    // Proceed with the rest of the program
+    DEBUG_PRINTF("[DEBUG]: All input parameters are valid.\n");
+
+    if (debug_output) {
+        printf("---------------------------------\n");
+        printf("Parsed input:\n");
+        printf("Function: %s\n",         params->function_str);
+        printf("Output file: %s\n",      params->output_file_str);
+        printf("X limits: [%lf, %lf]\n", params->x_min, params->x_max);
+        printf("Y limits: [%lf, %lf]\n", params->y_min, params->y_max);
+        printf("---------------------------------\n");
+    }
+
+    // A plot rendered before is copied from the cache directory instead of evaluated
+    char cache_key[RENDER_CACHE_KEY_SIZE];
+    if (options->render_cache_dir != NULL) {
+        if (stats != NULL) {
+            begin_stage(&mark);
+        }
+        span = begin_trace_span();
+        render_cache_key(options, params, cache_key);
+        bool hit = fetch_cached_render(options->render_cache_dir, cache_key, params->output_file_str,
+                                       &context->disk_cache);
+        end_trace_span("fetch_cached_render", span, "hit", hit);
+        if (stats != NULL) {
+            end_stage(stats, STAGE_CACHE, &mark);
+        }
+        if (hit) {
+            DEBUG_PRINTF("[DEBUG]: Render cache hit %s\n", cache_key);
+            free_input_params(params);
+            return SUCCESS;
+        }
+        DEBUG_PRINTF("[DEBUG]: Render cache miss %s\n", cache_key);
+    }
+
+    int status = render_params(context, options, params);
+    if (status == SUCCESS && options->render_cache_dir != NULL) {
+        if (stats != NULL) {
+            begin_stage(&mark);
+        }
+        span = begin_trace_span();
+        store_cached_render(options->render_cache_dir, (long long)options->render_cache_mb * 1024 * 1024,
+                            cache_key, params->output_file_str, &context->disk_cache);
+        end_trace_span("store_cached_render", span, NULL, 0);
+        if (stats != NULL) {
+            end_stage(stats, STAGE_CACHE, &mark);
+        }
+    }
+    free_input_params(params);
+    return status;
+}
+
+int render_plot(render_context_t* context, const program_options_t* options,
+                const char* function_arg, const char* output_arg, const char* limits_arg) {
+    render_stats_t* stats = context->stats;
+    if (stats == NULL) {
+        unsigned long long span = begin_trace_span();
+        int status = render_input(context, options, function_arg, output_arg, limits_arg);
+        end_trace_span("render_plot", span, "status", status);
+        return status;
+    }
+
+    unsigned long long span = begin_trace_span();
+    double wall = monotonic_seconds();
+    double cpu = process_cpu_seconds();
+    int status = render_input(context, options, function_arg, output_arg, limits_arg);
+    end_trace_span("render_plot", span, "status", status);
+    stats->total.wall += monotonic_seconds() - wall;
+    stats->total.cpu  += process_cpu_seconds() - cpu;
+    return status;
+}
@@ -0,0 +1,49 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "parse_input.h"
+#include "sampler.h"
+#include "postscriptexport.h"
+#include "expression_cache.h"
+#include "render_cache.h"
+#include "render_stats.h"
+
+// State kept between plots, so a batch does not allocate it again for every job
+typedef struct {
+    ps_export_t     export;    // the buffer of its writer is reused
+    sample_buffer_t workspace; // window of the grid sampler
+    expression_cache_t* cache; // compiled expressions kept between plots, NULL compiles every time
+    render_cache_stats_t disk_cache; // lookups in the directory of --render-cache
+    render_stats_t* stats;     // timings and counters of --stats, NULL collects none
+    FILE* profile_output;      // receives the report of --profile-eval, NULL evaluates without counters
+} render_context_t;
+
+// Initializing an empty context without a cache
+void init_render_context(render_context_t* context);
+
+// Releasing the buffers of a context
+void free_render_context(render_context_t* context);
+
+/**
+ * @brief Renders one plot, from the command line arguments to the PostScript file.
+ *
+ * @param context Buffers reused between plots
+ * @param options Command line options
+ * @param function_arg Function of x
+ * @param output_arg Output file name
+ * @param limits_arg "x_min:x_max:y_min:y_max", NULL for the default limits
+ * @return int SUCCESS or one of the ERROR_ codes.
+ *
+ * Parses, validates, optimizes and compiles the function, then streams the
+ * samples through the optional decimation and writer thread into the file.
+ * With a cache in the context, a function seen before skips parsing,
+ * optimization and compilation. With --render-cache a plot rendered before,
+ * by any process, is copied from the cache directory instead.
+ */
+int render_plot(render_context_t* context, const program_options_t* options,
+                const char* function_arg, const char* output_arg, const char* limits_arg);
+
+// Short description of a status returned by render_plot()
+const char* render_status_text(int status);
+
+#endif // RENDER_H
@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif
+#include "render_cache.h"
+#include "defs.h"
+
+// Extension of the entries, the name before it is the key
+#define RENDER_CACHE_EXTENSION ".ps"
+// Prefix of the files being written
+#define RENDER_CACHE_TEMP_PREFIX "tmp-"
+
+// Entry found while enforcing the size bound
+typedef struct {
+    char            name[RENDER_CACHE_KEY_SIZE + sizeof(RENDER_CACHE_EXTENSION)];
+    long long       size;
+    struct timespec used; // modification time, set again on every hit
+} cache_entry_t;
+
+void render_cache_key(const program_options_t* options, const input_params_t* params,
+                      char key[RENDER_CACHE_KEY_SIZE]) {
+    // %a prints the doubles exactly
+    char fields[BUFFER_SIZE];
+    int length = snprintf(fields, sizeof(fields),
+                          "version %d\nlimits %a %a %a %a\nadaptive %a\ndecimate %a\nsimplify %a\n"
+                          "encoding %d\ngrid %a\nfunction ",
+                          RENDER_CACHE_VERSION, params->x_min, params->x_max, params->y_min, params->y_max,
+                          options->tolerance, options->decimate_columns, options->simplify_tolerance,
+                          (int)options->path_encoding, options->grid_units);
+
+    sha256_t hash;
+    sha256_init(&hash);
+    sha256_update(&hash, fields, (size_t)length);
+    sha256_update(&hash, params->function_str, strlen(params->function_str));
+    unsigned char digest[SHA256_DIGEST_SIZE];
+    sha256_final(&hash, digest);
+
+    for (int i = 0; i < SHA256_DIGEST_SIZE; i++) {
+        snprintf(key + 2 * i, 3, "%02x", digest[i]);
+    }
+}
+
+// Path of the entry of a key, false if it does not fit
+static bool entry_path(const char* directory, const char* key, char* path, size_t size) {
+    int length = snprintf(path, size, "%s/%s" RENDER_CACHE_EXTENSION, directory, key);
+    return length > 0 && (size_t)length < size;
+}
+
+// Copying a whole file into another, cloning the blocks where the file system allows it
+static bool copy_contents(int from, int to) {
+#ifdef FICLONE
+    if (ioctl(to, FICLONE, from) == 0) {
+        return true;
+    }
+#endif
+    char buffer[64 * 1024];
+    for (;;) {
+        ssize_t read_bytes = read(from, buffer, sizeof(buffer));
+        if (read_bytes < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read_bytes <= 0) {
+            return read_bytes == 0;
+        }
+        for (ssize_t done = 0; done < read_bytes;) {
+            ssize_t written = write(to, buffer + done, (size_t)(read_bytes - done));
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            done += written;
+        }
+    }
+}
+
+bool fetch_cached_render(const char* directory, const char* key, const char* output_file,
+                         render_cache_stats_t* stats) {
+    char path[BUFFER_SIZE];
+    int from = entry_path(directory, key, path, sizeof(path)) ? open(path, O_RDONLY) : -1;
+    if (from < 0) {
+        stats->misses++;
+        return false;
+    }
+
+    // An entry evicted meanwhile stays readable through the open descriptor
+    int to = open(output_file, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    bool copied = to >= 0 && copy_contents(from, to);
+    if (to >= 0 && close(to) != 0) {
+        copied = false;
+    }
+    close(from);
+    if (!copied) {
+        DEBUG_PRINTF("[DEBUG]: Copying the cached rendering %s failed\n", path);
+        stats->misses++;
+        return false;
+    }
+
+    // The modification time orders the entries for eviction
+    utimensat(AT_FDCWD, path, NULL, 0);
+    stats->hits++;
+    return true;
+}
+
+static int compare_entry_use(const void* a, const void* b) {
+    const struct timespec* x = &((const cache_entry_t*)a)->used;
+    const struct timespec* y = &((const cache_entry_t*)b)->used;
+    if (x->tv_sec != y->tv_sec) {
+        return x->tv_sec < y->tv_sec ? -1 : 1;
+    }
+    return (x->tv_nsec > y->tv_nsec) - (x->tv_nsec < y->tv_nsec);
+}
+
+// Checking if a file name is a key followed by the extension
+static bool is_entry_name(const char* name) {
+    size_t key_length = RENDER_CACHE_KEY_SIZE - 1;
+    if (strlen(name) != key_length + strlen(RENDER_CACHE_EXTENSION) ||
+        strcmp(name + key_length, RENDER_CACHE_EXTENSION) != 0) {
+        return false;
+    }
+    return strspn(name, "0123456789abcdef") == key_length;
+}
+
+// Removing the least recently used entries until the rest fits, and stale temporary files
+static void evict_entries(const char* directory, long long max_bytes, render_cache_stats_t* stats) {
+    DIR* dir = opendir(directory);
+    if (dir == NULL) {
+        return;
+    }
+
+    cache_entry_t* entries = NULL;
+    int count = 0;
+    int capacity = 0;
+    long long total = 0;
+    time_t now = time(NULL);
+    char path[BUFFER_SIZE];
+    struct stat info;
+
+    struct dirent* item;
+    while ((item = readdir(dir)) != NULL) {
+        bool temporary = strncmp(item->d_name, RENDER_CACHE_TEMP_PREFIX, strlen(RENDER_CACHE_TEMP_PREFIX)) == 0;
+        if ((!temporary && !is_entry_name(item->d_name)) ||
+            snprintf(path, sizeof(path), "%s/%s", directory, item->d_name) >= (int)sizeof(path) ||
+            stat(path, &info) != 0) {
+            continue;
+        }
+        if (temporary) {
+            if (now - info.st_mtime > RENDER_CACHE_STALE_SECONDS) {
+                unlink(path);
+            }
+            continue;
+        }
+
+        if (count == capacity) {
+            capacity = capacity == 0 ? 64 : 2 * capacity;
+            cache_entry_t* grown = (cache_entry_t*)realloc(entries, capacity * sizeof(cache_entry_t));
+            if (grown == NULL) {
+                break;
+            }
+            entries = grown;
+        }
+        strcpy(entries[count].name, item->d_name);
+        entries[count].size = (long long)info.st_size;
+        entries[count].used = info.st_mtim;
+        total += entries[count].size;
+        count++;
+    }
+    closedir(dir);
+
+    if (total > max_bytes) {
+        qsort(entries, count, sizeof(cache_entry_t), compare_entry_use);
+        for (int i = 0; i < count && total > max_bytes; i++) {
+            snprintf(path, sizeof(path), "%s/%s", directory, entries[i].name);
+            // Another process may have removed it already, its space is gone either way
+            if (unlink(path) == 0) {
+                stats->evictions++;
+            }
+            total -= entries[i].size;
+        }
+    }
+    free(entries);
+}
+
+bool store_cached_render(const char* directory, long long max_bytes, const char* key,
+                         const char* output_file, render_cache_stats_t* stats) {
+    char path[BUFFER_SIZE];
+    char temp_path[BUFFER_SIZE];
+    if (!entry_path(directory, key, path, sizeof(path)) ||
+        snprintf(temp_path, sizeof(temp_path), "%s/" RENDER_CACHE_TEMP_PREFIX "XXXXXX", directory) >= (int)sizeof(temp_path)) {
+        return false;
+    }
+    if (mkdir(directory, 0777) != 0 && errno != EEXIST) {
+        DEBUG_PRINTF("[DEBUG]: Cannot create the render cache %s\n", directory);
+        return false;
+    }
+
+    int to = mkstemp(temp_path);
+    if (to < 0) {
+        DEBUG_PRINTF("[DEBUG]: Cannot write to the render cache %s\n", directory);
+        return false;
+    }
+    int from = open(output_file, O_RDONLY);
+    bool copied = from >= 0 && copy_contents(from, to) && fchmod(to, 0644) == 0;
+    if (close(to) != 0) {
+        copied = false;
+    }
+    if (from >= 0) {
+        close(from);
+    }
+
+    // Readers see either no entry or the complete one
+    if (!copied || rename(temp_path, path) != 0) {
+        unlink(temp_path);
+        return false;
+    }
+    stats->stores++;
+
+    evict_entries(directory, max_bytes, stats);
+    return true;
+}
@@ -0,0 +1,78 @@
+#ifndef RENDER_CACHE_H
+#define RENDER_CACHE_H
+
+#include <stdbool.h>
+#include "parse_input.h"
+#include "sha256.h"
+
+// Part of every key, raised whenever the same input renders differently
+#define RENDER_CACHE_VERSION 2
+
+// Default size bound of the cache directory in megabytes
+#define RENDER_CACHE_DEFAULT_MB 256
+// Upper bound for --render-cache-size
+#define RENDER_CACHE_MAX_MB (1024 * 1024)
+
+// Temporary files older than this are left over by a crashed process and removed
+#define RENDER_CACHE_STALE_SECONDS 3600
+
+// Hexadecimal key plus the terminating zero
+#define RENDER_CACHE_KEY_SIZE (2 * SHA256_DIGEST_SIZE + 1)
+
+// Counters of the cache lookups of one render context
+typedef struct {
+    long long hits;
+    long long misses;
+    long long stores;    // rendered files added to the cache
+    long long evictions; // entries removed to stay under the size bound
+} render_cache_stats_t;
+
+/**
+ * @brief Computes the cache key of a plot.
+ *
+ * @param options Options of the run
+ * @param params Validated input, the function in its canonical form
+ * @param key Receives the SHA-256 of the key fields in hexadecimal
+ *
+ * The key covers RENDER_CACHE_VERSION, the function string after
+ * remove_spaces() and the scientific notation conversion of check_number(),
+ * the exact limits and every option that changes the file: adaptive
+ * tolerance, decimation, simplification, path encoding and grid. Threads,
+ * JIT, culling and the writer thread give the same bytes and are left out.
+ */
+void render_cache_key(const program_options_t* options, const input_params_t* params,
+                      char key[RENDER_CACHE_KEY_SIZE]);
+
+/**
+ * @brief Copies a cached rendering to the output file.
+ *
+ * @param directory Cache directory
+ * @param key Key from render_cache_key()
+ * @param output_file File to write
+ * @param stats Counts the hit or miss
+ * @return true on a hit, the output file is then complete.
+ *
+ * The file is cloned where the file system supports it (FICLONE), copied
+ * otherwise. A hit marks the entry as recently used.
+ */
+bool fetch_cached_render(const char* directory, const char* key, const char* output_file,
+                         render_cache_stats_t* stats);
+
+/**
+ * @brief Adds a rendered file to the cache and evicts the least recently used entries.
+ *
+ * @param directory Cache directory, created if missing
+ * @param max_bytes Size bound of the entries
+ * @param key Key from render_cache_key()
+ * @param output_file Rendered file
+ * @param stats Counts the store and the evictions
+ * @return true if the entry was added.
+ *
+ * The entry is written to a temporary file and renamed into place, so
+ * processes sharing the directory never see a partial file. Failures only
+ * mean the next lookup misses.
+ */
+bool store_cached_render(const char* directory, long long max_bytes, const char* key,
+                         const char* output_file, render_cache_stats_t* stats);
+
+#endif // RENDER_CACHE_H
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "parse_input.h"
+#include "render_daemon.h"
+
+// Appending one quoted word to the request line, false if it does not fit or cannot be quoted
+static bool append_word(char* line, size_t size, const char* word) {
+    char quote = strchr(word, '"') == NULL ? '"' : '\'';
+    if (strchr(word, quote) != NULL || strchr(word, '\n') != NULL) {
+        return false;
+    }
+    size_t used = strlen(line);
+    int length = snprintf(line + used, size - used, "%s%c%s%c", used > 0 ? " " : "", quote, word, quote);
+    return length >= 0 && (size_t)length < size - used;
+}
+
+// Reading the response header up to its newline, byte by byte so no payload is consumed
+static bool read_header(int fd, char* header, size_t size) {
+    size_t used = 0;
+    while (used + 1 < size) {
+        ssize_t received = recv(fd, header + used, 1, 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0) {
+            return false;
+        }
+        if (header[used] == '\n') {
+            header[used] = '\0';
+            return true;
+        }
+        used++;
+    }
+    return false;
+}
+
+// Copying the payload to standard output
+static bool copy_payload(int fd, long long length) {
+    char buffer[16 * 1024];
+    while (length > 0) {
+        ssize_t received = recv(fd, buffer, length < (long long)sizeof(buffer) ? (size_t)length : sizeof(buffer), 0);
+        if (received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (received <= 0 || fwrite(buffer, 1, (size_t)received, stdout) != (size_t)received) {
+            return false;
+        }
+        length -= received;
+    }
+    return fflush(stdout) == 0;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        fprintf(stderr, "Usage: %s <socket> render [options] <function> <output_file|-> [<limits>]\n"
+                        "       %s <socket> stats|shutdown\n", argv[0], argv[0]);
+        return ERROR_ARG_COUNT;
+    }
+
+    char line[DAEMON_MAX_REQUEST] = "";
+    for (int i = 2; i < argc; i++) {
+        if (!append_word(line, sizeof(line) - 1, argv[i])) {
+            fprintf(stderr, "Error: Request too long or argument cannot be quoted: %s\n", argv[i]);
+            return ERROR_ARG_COUNT;
+        }
+    }
+    strcat(line, "\n");
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(argv[1]) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Error: Socket path too long: %s\n", argv[1]);
+        return ERROR_DAEMON_SOCKET;
+    }
+    strcpy(address.sun_path, argv[1]);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        perror("Error connecting to the daemon");
+        if (fd >= 0) {
+            close(fd);
+        }
+        return ERROR_DAEMON_SOCKET;
+    }
+
+    char header[DAEMON_MAX_REQUEST];
+    bool sent = send(fd, line, strlen(line), MSG_NOSIGNAL) == (ssize_t)strlen(line);
+    if (!sent || !read_header(fd, header, sizeof(header))) {
+        fprintf(stderr, "Error: No response from the daemon\n");
+        close(fd);
+        return ERROR_DAEMON_SOCKET;
+    }
+
+    // "ok <length>" with the payload, or "error <code> <text>"
+    int status = SUCCESS;
+    long long length = 0;
+    int offset = 0;
+    if (sscanf(header, "ok %lld", &length) == 1) {
+        if (!copy_payload(fd, length)) {
+            fprintf(stderr, "Error: Response cut short\n");
+            status = ERROR_DAEMON_SOCKET;
+        }
+    } else if (sscanf(header, "error %d %n", &status, &offset) == 1) {
+        fprintf(stderr, "Error %d: %s\n", status, header + offset);
+    } else {
+        fprintf(stderr, "Error: Malformed response: %s\n", header);
+        status = ERROR_DAEMON_SOCKET;
+    }
+    close(fd);
+    return status;
+}
@@ -0,0 +1,381 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "render_daemon.h"
+#include "defs.h"
+#include "render.h"
+#include "parser_utils.h"
+#include "timing.h"
+#include "trace.h"
+
+// Set by SIGINT and SIGTERM
+static volatile sig_atomic_t stop_requested = 0;
+
+static void request_stop(int signal_number) {
+    (void)signal_number;
+    stop_requested = 1;
+}
+
+// Open connection and the part of its next request received so far
+typedef struct {
+    int    fd;
+    size_t used;                         // bytes in buffer
+    double deadline;                     // monotonic time by which the next line must be complete
+    char   buffer[DAEMON_MAX_REQUEST];
+} daemon_connection_t;
+
+// State of the daemon between requests
+typedef struct {
+    render_context_t   context;
+    expression_cache_t cache;
+    char      scratch_file[64];                    // output of requests answered with the bytes
+    double    latencies_ms[DAEMON_LATENCY_SAMPLES]; // ring of the latest render durations
+    long long num_requests;                        // render requests served
+    long long num_errors;                          // of which failed
+    bool      shutdown;
+    daemon_connection_t connections[DAEMON_MAX_CONNECTIONS];
+    int       num_connections;
+} daemon_state_t;
+
+// Sending all bytes, false if the client went away
+static bool send_all(int fd, const void* data, size_t size) {
+    const char* bytes = (const char*)data;
+    while (size > 0) {
+        ssize_t sent = send(fd, bytes, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return false;
+        }
+        bytes += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+static bool send_error(int fd, int status, const char* text) {
+    char header[DAEMON_MAX_REQUEST];
+    int length = snprintf(header, sizeof(header), "error %d %s\n", status, text);
+    return send_all(fd, header, (size_t)length);
+}
+
+static bool send_payload(int fd, const char* payload, size_t size) {
+    char header[64];
+    int length = snprintf(header, sizeof(header), "ok %zu\n", size);
+    return send_all(fd, header, (size_t)length) && send_all(fd, payload, size);
+}
+
+// Sending a rendered file as the payload
+static bool send_file(int fd, const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    struct stat info;
+    if (file == NULL || fstat(fileno(file), &info) != 0) {
+        if (file != NULL) {
+            fclose(file);
+        }
+        return send_error(fd, ERROR_OUTPUT_FILE, render_status_text(ERROR_OUTPUT_FILE));
+    }
+
+    char buffer[BUFFER_SIZE * 16];
+    int length = snprintf(buffer, sizeof(buffer), "ok %lld\n", (long long)info.st_size);
+    bool sent = send_all(fd, buffer, (size_t)length);
+    size_t read_bytes;
+    while (sent && (read_bytes = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        sent = send_all(fd, buffer, read_bytes);
+    }
+    fclose(file);
+    return sent;
+}
+
+// Answering the stats command
+static bool send_stats(int fd, const daemon_state_t* state) {
+    int count = state->num_requests < DAEMON_LATENCY_SAMPLES ? (int)state->num_requests : DAEMON_LATENCY_SAMPLES;
+    double sorted[DAEMON_LATENCY_SAMPLES];
+    memcpy(sorted, state->latencies_ms, count * sizeof(double));
+    sort_durations(sorted, count);
+
+    const expression_cache_t* cache = &state->cache;
+    const render_cache_stats_t* disk_cache = &state->context.disk_cache;
+    char payload[BUFFER_SIZE];
+    int length = snprintf(payload, sizeof(payload),
+                          "requests %lld\n"
+                          "errors %lld\n"
+                          "latency_p50_ms %.3f\n"
+                          "latency_p99_ms %.3f\n"
+                          "cache_entries %d\n"
+                          "cache_capacity %d\n"
+                          "cache_hits %lld\n"
+                          "cache_misses %lld\n"
+                          "cache_evictions %lld\n"
+                          "render_cache_hits %lld\n"
+                          "render_cache_misses %lld\n"
+                          "render_cache_stores %lld\n"
+                          "render_cache_evictions %lld\n",
+                          state->num_requests, state->num_errors,
+                          duration_percentile(sorted, count, 50), duration_percentile(sorted, count, 99),
+                          cache->count, cache->capacity, cache->hits, cache->misses, cache->evictions,
+                          disk_cache->hits, disk_cache->misses, disk_cache->stores, disk_cache->evictions);
+    return send_payload(fd, payload, (size_t)length);
+}
+
+// Rendering one request, the words after the command are a plain command line
+static bool serve_render(int fd, daemon_state_t* state, int argc, char* argv[]) {
+    double start = monotonic_seconds();
+    set_trace_job((int)(state->num_requests + 1));
+    unsigned long long span = begin_trace_span();
+
+    program_options_t options;
+    int status = SUCCESS;
+    argc = extract_options(&options, argc, argv);
+    end_trace_span("extract_options", span, NULL, 0);
+    if (argc < 0) {
+        status = ERROR_ARG_COUNT;
+    } else if (options.batch_path != NULL || options.daemon_path != NULL || options.trace_path != NULL ||
+               argc < 3 || argc > 4) {
+        status = ERROR_ARG_COUNT;
+    }
+
+    bool to_client = status == SUCCESS && strcmp(argv[2], "-") == 0;
+    if (status == SUCCESS) {
+        status = render_plot(&state->context, &options, argv[1], to_client ? state->scratch_file : argv[2],
+                             argc == 4 ? argv[3] : NULL);
+    }
+
+    bool sent;
+    if (status != SUCCESS) {
+        sent = send_error(fd, status, render_status_text(status));
+    } else if (to_client) {
+        sent = send_file(fd, state->scratch_file);
+    } else {
+        sent = send_payload(fd, "", 0);
+    }
+    if (to_client) {
+        unlink(state->scratch_file);
+    }
+
+    state->latencies_ms[state->num_requests % DAEMON_LATENCY_SAMPLES] = (monotonic_seconds() - start) * 1e3;
+    state->num_requests++;
+    state->num_errors += status != SUCCESS;
+    end_trace_span("request", span, "status", status);
+    set_trace_job(0);
+    return sent;
+}
+
+// Answering one request line, false when the connection should be closed
+static bool serve_request(int fd, daemon_state_t* state, char* line) {
+    // One more slot, extract_options() ends the kept arguments with NULL
+    char* argv[DAEMON_MAX_ARGUMENTS + 1];
+    int argc = split_arguments(line, argv, DAEMON_MAX_ARGUMENTS);
+    if (argc <= 0) {
+        return send_error(fd, ERROR_ARG_COUNT, argc == 0 ? "empty request" : "malformed request");
+    }
+
+    if (strcmp(argv[0], "render") == 0) {
+        return serve_render(fd, state, argc, argv);
+    }
+    if (strcmp(argv[0], "stats") == 0 && argc == 1) {
+        return send_stats(fd, state);
+    }
+    if (strcmp(argv[0], "shutdown") == 0 && argc == 1) {
+        state->shutdown = true;
+        send_payload(fd, "", 0);
+        return false;
+    }
+    return send_error(fd, ERROR_ARG_COUNT, "unknown request");
+}
+
+// Answering the complete lines received on a connection, false when it should be closed
+static bool serve_lines(daemon_connection_t* connection, daemon_state_t* state) {
+    char* buffer = connection->buffer;
+    char* newline;
+    while (!state->shutdown && !stop_requested && (newline = memchr(buffer, '\n', connection->used)) != NULL) {
+        *newline = END_STRING_CHAR;
+        if (newline > buffer && newline[-1] == '\r') {
+            newline[-1] = END_STRING_CHAR;
+        }
+        if (!serve_request(connection->fd, state, buffer)) {
+            return false;
+        }
+        size_t rest = connection->used - (size_t)(newline + 1 - buffer);
+        memmove(buffer, newline + 1, rest);
+        connection->used = rest;
+        connection->deadline = monotonic_seconds() + DAEMON_REQUEST_SECONDS;
+    }
+    if (connection->used == sizeof(connection->buffer)) {
+        send_error(connection->fd, ERROR_ARG_COUNT, "request too long");
+        return false;
+    }
+    return true;
+}
+
+// Reading what a connection has sent, false when it should be closed
+static bool receive_request(daemon_connection_t* connection, daemon_state_t* state) {
+    ssize_t received = recv(connection->fd, connection->buffer + connection->used,
+                            sizeof(connection->buffer) - connection->used, MSG_DONTWAIT);
+    if (received < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)) {
+        return true;
+    }
+    if (received <= 0) {
+        return false;
+    }
+    connection->used += (size_t)received;
+    return serve_lines(connection, state);
+}
+
+// Accepting a connection, a client that stops reading its response is dropped after the request deadline
+static void accept_connection(int listen_fd, daemon_state_t* state) {
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd < 0) {
+        if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+            perror("Error accepting a connection");
+        }
+        return;
+    }
+    struct timeval timeout = {DAEMON_REQUEST_SECONDS, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    daemon_connection_t* connection = &state->connections[state->num_connections++];
+    connection->fd = fd;
+    connection->used = 0;
+    connection->deadline = monotonic_seconds() + DAEMON_REQUEST_SECONDS;
+}
+
+// Closing a connection, the last one takes its slot
+static void close_connection(daemon_state_t* state, int index) {
+    close(state->connections[index].fd);
+    state->num_connections--;
+    if (index != state->num_connections) {
+        state->connections[index] = state->connections[state->num_connections];
+    }
+}
+
+// Waiting for new connections and request data on all connections, serving each complete line
+static void serve_connections(int listen_fd, daemon_state_t* state) {
+    struct pollfd fds[DAEMON_MAX_CONNECTIONS + 1];
+    while (!state->shutdown && !stop_requested) {
+        // The nearest deadline bounds the wait; a full table leaves new clients in the backlog
+        double now = monotonic_seconds();
+        double nearest = now + DAEMON_REQUEST_SECONDS;
+        fds[0].fd = state->num_connections < DAEMON_MAX_CONNECTIONS ? listen_fd : -1;
+        fds[0].events = POLLIN;
+        for (int i = 0; i < state->num_connections; i++) {
+            fds[i + 1].fd = state->connections[i].fd;
+            fds[i + 1].events = POLLIN;
+            if (state->connections[i].deadline < nearest) {
+                nearest = state->connections[i].deadline;
+            }
+        }
+        int count = state->num_connections;
+        int timeout_ms = nearest > now ? (int)((nearest - now) * 1e3) + 1 : 0;
+        if (poll(fds, (nfds_t)count + 1, timeout_ms) < 0) {
+            if (errno != EINTR) {
+                perror("Error waiting for connections");
+            }
+            continue;
+        }
+
+        // Backwards, so closing a connection moves only one that is already handled
+        for (int i = count - 1; i >= 0 && !state->shutdown && !stop_requested; i--) {
+            daemon_connection_t* connection = &state->connections[i];
+            bool open = true;
+            if (fds[i + 1].revents != 0) {
+                open = receive_request(connection, state);
+            }
+            if (open && monotonic_seconds() > connection->deadline) {
+                DEBUG_PRINTF("[DEBUG]: Closing a connection that did not complete a request in %d s\n",
+                             DAEMON_REQUEST_SECONDS);
+                open = false;
+            }
+            if (!open) {
+                close_connection(state, i);
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            accept_connection(listen_fd, state);
+        }
+    }
+}
+
+// Opening the listening socket, replacing a stale one
+static int open_socket(const char* socket_path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Error: Socket path too long: %s\n", socket_path);
+        return -1;
+    }
+    strcpy(address.sun_path, socket_path);
+
+    struct stat info;
+    if (lstat(socket_path, &info) == 0 && S_ISSOCK(info.st_mode)) {
+        unlink(socket_path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("Error creating the socket");
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        perror("Error listening on the socket");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int run_daemon(const char* socket_path, const program_options_t* options) {
+    if (socket_path == NULL || options == NULL) {
+        return ERROR_DAEMON_SOCKET;
+    }
+
+    daemon_state_t* state = (daemon_state_t*)calloc(1, sizeof(daemon_state_t));
+    if (state == NULL) {
+        fprintf(stderr, "Error: Memory allocation failed in run_daemon\n");
+        return ERROR_MEMORY_ALLOCATION;
+    }
+    int listen_fd = open_socket(socket_path);
+    if (listen_fd < 0) {
+        free(state);
+        return ERROR_DAEMON_SOCKET;
+    }
+
+    // No SA_RESTART, so a signal interrupts poll()
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = request_stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    init_render_context(&state->context);
+    init_expression_cache(&state->cache, options->cache_entries);
+    state->context.cache = &state->cache;
+    snprintf(state->scratch_file, sizeof(state->scratch_file), ".render-daemon-%ld.ps", (long)getpid());
+
+    printf("Render daemon listening on %s\n", socket_path);
+    fflush(stdout);
+
+    serve_connections(listen_fd, state);
+    while (state->num_connections > 0) {
+        close_connection(state, state->num_connections - 1);
+    }
+
+    printf("Render daemon stopped after %lld requests\n", state->num_requests);
+    close(listen_fd);
+    unlink(socket_path);
+    free_expression_cache(&state->cache);
+    free_render_context(&state->context);
+    free(state);
+    return SUCCESS;
+}
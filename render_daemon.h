@@ -0,0 +1,49 @@
+#ifndef RENDER_DAEMON_H
+#define RENDER_DAEMON_H
+
+#include "parse_input.h"
+
+// Longest request line, the longest response header
+#define DAEMON_MAX_REQUEST 4096
+// Most words of a request: command, options, function, output file and limits
+#define DAEMON_MAX_ARGUMENTS 32
+// Latest request durations kept for the percentiles of the stats command
+#define DAEMON_LATENCY_SAMPLES 4096
+// Seconds a connection has to complete each request line, counted from the end of the previous one
+#define DAEMON_REQUEST_SECONDS 10
+// Connections served at once, further clients wait in the listen backlog
+#define DAEMON_MAX_CONNECTIONS 64
+
+/**
+ * @brief Serves render requests on a Unix domain socket until shut down.
+ *
+ * @param socket_path Path of the socket, a stale socket file there is replaced
+ * @param options Options of the daemon itself, the cache size comes from here
+ * @return int SUCCESS, or ERROR_DAEMON_SOCKET if the socket cannot be opened.
+ *
+ * Each request is one line of blank-separated words, quoted like a job list:
+ *
+ *   render [options] <function> <output_file|-> [<limits>]
+ *   stats
+ *   shutdown
+ *
+ * A render request takes the same options and arguments as a plain run, the
+ * options of the daemon do not apply to it. Output "-" sends the PostScript
+ * back instead of leaving a file in the working directory of the daemon.
+ * Every response starts with "ok <length>\n" followed by <length> bytes of
+ * payload, or is a single "error <code> <text>\n" line. stats answers with
+ * "name value" lines: request and error counts, p50/p99 render latency and
+ * the cache counters. A connection may send several requests in turn.
+ *
+ * The daemon waits on all connections at once with poll() and answers each
+ * request as soon as its line is complete, so a slow or silent client does
+ * not hold up the others. A connection that does not complete a line within
+ * DAEMON_REQUEST_SECONDS, or stops reading its response for that long, is
+ * closed. Requests are still rendered one at a time. Compiled expressions
+ * stay in an LRU cache keyed by the normalized function string, so a
+ * repeated function skips parsing, optimization and compilation. SIGINT and
+ * SIGTERM stop the daemon like shutdown.
+ */
+int run_daemon(const char* socket_path, const program_options_t* options);
+
+#endif // RENDER_DAEMON_H
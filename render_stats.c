@@ -0,0 +1,69 @@
+#include <string.h>
+#include <sys/resource.h>
+#include "render_stats.h"
+#include "heap_usage.h"
+#include "timing.h"
+
+static const char* STAGE_NAMES[NUM_RENDER_STAGES] = {
+    "arguments", "validation", "cache", "parsing", "compilation", "evaluation", "export"
+};
+
+void init_render_stats(render_stats_t* stats) {
+    memset(stats, 0, sizeof(render_stats_t));
+    stats->decimated = -1;
+    reset_heap_peak();
+}
+
+void begin_stage(stage_mark_t* mark) {
+    mark->wall = monotonic_seconds();
+    mark->cpu  = process_cpu_seconds();
+}
+
+void end_stage(render_stats_t* stats, render_stage_t stage, const stage_mark_t* mark) {
+    stats->stages[stage].wall += monotonic_seconds() - mark->wall;
+    stats->stages[stage].cpu  += process_cpu_seconds() - mark->cpu;
+    stats->peak_heap = heap_peak_bytes();
+}
+
+// Reading the peak resident set size, kilobytes on Linux
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    return getrusage(RUSAGE_SELF, &usage) == 0 ? usage.ru_maxrss : 0;
+}
+
+void print_render_stats(FILE* file, const render_stats_t* stats, stats_format_t format) {
+    long rss = peak_rss_kb();
+
+    if (format == STATS_JSON) {
+        fprintf(file, "{\"stages\": {");
+        for (int s = 0; s < NUM_RENDER_STAGES; s++) {
+            fprintf(file, "%s\"%s\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}", s > 0 ? ", " : "",
+                    STAGE_NAMES[s], stats->stages[s].wall * 1e3, stats->stages[s].cpu * 1e3);
+        }
+        fprintf(file, "}, \"total\": {\"wall_ms\": %.3f, \"cpu_ms\": %.3f}, ",
+                stats->total.wall * 1e3, stats->total.cpu * 1e3);
+        fprintf(file, "\"points\": {\"evaluated\": %lld, \"culled\": %lld, \"undefined\": %lld, \"kept\": %lld, "
+                      "\"decimated\": %lld, \"written\": %lld}, ",
+                stats->evaluated, stats->culled, stats->undefined, stats->kept, stats->decimated, stats->written);
+        fprintf(file, "\"segments\": {\"moveto\": %lld, \"lineto\": %lld}, \"bytes_written\": %lld, ",
+                stats->moves, stats->lines, stats->bytes);
+        fprintf(file, "\"peak_heap_bytes\": %lld, \"peak_rss_kb\": %ld}\n", stats->peak_heap, rss);
+        return;
+    }
+
+    fprintf(file, "---------------------------------\n");
+    fprintf(file, "%-12s %12s %12s\n", "stage", "wall ms", "cpu ms");
+    for (int s = 0; s < NUM_RENDER_STAGES; s++) {
+        fprintf(file, "%-12s %12.3f %12.3f\n", STAGE_NAMES[s], stats->stages[s].wall * 1e3, stats->stages[s].cpu * 1e3);
+    }
+    fprintf(file, "%-12s %12.3f %12.3f\n", "total", stats->total.wall * 1e3, stats->total.cpu * 1e3);
+    fprintf(file, "Points: %lld evaluated, %lld culled, %lld undefined, %lld kept",
+            stats->evaluated, stats->culled, stats->undefined, stats->kept);
+    if (stats->decimated >= 0) {
+        fprintf(file, ", %lld after decimation", stats->decimated);
+    }
+    fprintf(file, ", %lld written\n", stats->written);
+    fprintf(file, "Segments: %lld moveto, %lld lineto, %lld bytes written\n", stats->moves, stats->lines, stats->bytes);
+    fprintf(file, "Memory: %.1f KB peak heap, %ld KB peak RSS\n", stats->peak_heap / 1024.0, rss);
+    fprintf(file, "---------------------------------\n");
+}
@@ -0,0 +1,66 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <stdio.h>
+#include <stdbool.h>
+
+// Stages of a plot timed by --stats
+typedef enum {
+    STAGE_ARGUMENTS,   // function, output file and limits taken from the arguments
+    STAGE_VALIDATION,  // normalization, validation and the limit check
+    STAGE_CACHE,       // lookups and stores of --render-cache
+    STAGE_PARSING,     // parse_expression()
+    STAGE_COMPILATION, // optimization, bytecode and native code
+    STAGE_EVALUATION,  // sampling, interval culling and decimation
+    STAGE_EXPORT,      // writing the PostScript file
+    NUM_RENDER_STAGES
+} render_stage_t;
+
+// Wall and CPU seconds spent in a stage
+typedef struct {
+    double wall;
+    double cpu;
+} stage_time_t;
+
+// Start of a timed section
+typedef struct {
+    double wall;
+    double cpu;
+} stage_mark_t;
+
+// Timings and counters of one plot, collected only when the render context points to them
+typedef struct {
+    stage_time_t stages[NUM_RENDER_STAGES];
+    stage_time_t total;
+    long long evaluated;  // points evaluated, culled ranges excluded
+    long long culled;     // points skipped by the interval test
+    long long undefined;  // evaluated points without a value (NaN)
+    long long kept;       // points inside the y range
+    long long decimated;  // points left by --decimate, -1 without it
+    long long written;    // points passed to the path encoding, after --simplify
+    long long moves;      // moveto segments written
+    long long lines;      // lineto segments written
+    long long bytes;      // size of the output file
+    long long peak_heap;  // highest heap use during the plot, in bytes
+} render_stats_t;
+
+// Output of --stats
+typedef enum {
+    STATS_OFF,
+    STATS_TEXT,
+    STATS_JSON
+} stats_format_t;
+
+// Clearing the timings and counters, and restarting the heap peak
+void init_render_stats(render_stats_t* stats);
+
+// Marking the start of a timed section
+void begin_stage(stage_mark_t* mark);
+
+// Adding the time since the mark to a stage, and taking over the heap peak
+void end_stage(render_stats_t* stats, render_stage_t stage, const stage_mark_t* mark);
+
+// Printing the timings and counters as a table or as one JSON object
+void print_render_stats(FILE* file, const render_stats_t* stats, stats_format_t format);
+
+#endif // RENDER_STATS_H
@@ -0,0 +1,459 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <pthread.h>
+#include "sampler.h"
+#include "defs.h"
+#include "postscriptexport.h"
+#include "trace.h"
+
+void init_sample_buffer(sample_buffer_t* buffer) {
+    if (buffer != NULL) {
+        memset(buffer, 0, sizeof(sample_buffer_t));
+    }
+}
+
+bool reserve_sample_buffer(sample_buffer_t* buffer, int capacity) {
+    if (buffer == NULL || capacity < 0) {
+        return false;
+    }
+    if (capacity <= buffer->capacity) {
+        return true;
+    }
+
+    double* x_values = (double*)realloc(buffer->x_values, capacity * sizeof(double));
+    if (x_values == NULL) {
+        return false;
+    }
+    buffer->x_values = x_values;
+
+    double* y_values = (double*)realloc(buffer->y_values, capacity * sizeof(double));
+    if (y_values == NULL) {
+        return false;
+    }
+    buffer->y_values = y_values;
+
+    bool* connected = (bool*)realloc(buffer->connected, capacity * sizeof(bool));
+    if (connected == NULL) {
+        return false;
+    }
+    buffer->connected = connected;
+
+    buffer->capacity = capacity;
+    return true;
+}
+
+void free_sample_buffer(sample_buffer_t* buffer) {
+    if (buffer == NULL) {
+        return;
+    }
+
+    free(buffer->x_values);
+    free(buffer->y_values);
+    free(buffer->connected);
+    init_sample_buffer(buffer);
+}
+
+// Kept points of one grid chunk, the flags tell if its first and last grid points are visible
+typedef struct {
+    int  kept;
+    int  culled;
+    int  undefined;  // NaN values, culled points included
+    bool first_visible;
+    bool last_visible;
+} chunk_result_t;
+
+// State shared by the sampling threads, for one window of chunks
+typedef struct {
+    const sample_job_t* job;
+    sample_buffer_t* window;      // SAMPLE_CHUNK_SIZE points of room per chunk
+    int              trace_job;   // job id of the spans of the sampling threads
+    chunk_result_t*  results;     // one per chunk of the window
+    long long        first_chunk; // grid chunk at the start of the window
+    int              num_chunks;  // chunks in the window
+    int              next_chunk;  // next chunk to claim, guarded by lock
+    pthread_mutex_t  lock;
+} sampler_state_t;
+
+// Evaluating count grid points, ranges proven invisible are set to NaN instead, returning their number
+static int evaluate_range(const sample_job_t* job, const double* xs, double* ys, int count) {
+    if (job->cull) {
+        Interval y = evaluate_program_interval(job->program, make_interval(xs[0], xs[count - 1]));
+        if (interval_outside(y, job->y_min, job->y_max)) {
+            for (int i = 0; i < count; i++) {
+                ys[i] = NAN;
+            }
+            return count;
+        }
+
+        // Partly visible at best, the halves may still be culled
+        if (count >= 2 * CULL_MIN_POINTS && !(y.lo >= job->y_min && y.hi <= job->y_max)) {
+            int half = count / 2;
+            return evaluate_range(job, xs, ys, half) + evaluate_range(job, xs + half, ys + half, count - half);
+        }
+    }
+
+    if (job->jit != NULL) {
+        jit_evaluate_batch(job->jit, xs, ys, count);
+    } else {
+        evaluate_expression_batch(job->program, xs, ys, count);
+    }
+    return 0;
+}
+
+// Evaluating the grid points [start, end), the kept points are written from offset on
+static chunk_result_t sample_chunk(const sample_job_t* job, long long start, long long end,
+                                   sample_buffer_t* buffer, int offset) {
+    double block_x[SAMPLE_BLOCK_SIZE];
+    double block_y[SAMPLE_BLOCK_SIZE];
+    chunk_result_t result = {0, 0, 0, false, false};
+    bool previous_visible = false;
+
+    for (long long first = start; first < end; first += SAMPLE_BLOCK_SIZE) {
+        int count = end - first < SAMPLE_BLOCK_SIZE ? (int)(end - first) : SAMPLE_BLOCK_SIZE;
+        for (int i = 0; i < count; i++) {
+            // A -0 limit gives +0 at i = 0, the optimizer relies on it
+            block_x[i] = job->x_min + (double)(first + i) * job->step;
+        }
+
+        result.culled += evaluate_range(job, block_x, block_y, count);
+
+        for (int i = 0; i < count; i++) {
+            bool visible = block_y[i] >= job->y_min && block_y[i] <= job->y_max;
+            if (visible) {
+                int index = offset + result.kept;
+                buffer->x_values[index]  = block_x[i];
+                buffer->y_values[index]  = block_y[i];
+                buffer->connected[index] = previous_visible;
+                ++result.kept;
+            } else {
+                result.undefined += isnan(block_y[i]) != 0;
+            }
+            if (first + i == start) {
+                result.first_visible = visible;
+            }
+            previous_visible = visible;
+        }
+    }
+    result.last_visible = previous_visible;
+    return result;
+}
+
+// Thread body: claiming chunks of the window until none is left
+static void* sampler_worker(void* arg) {
+    sampler_state_t* state = (sampler_state_t*)arg;
+    const sample_job_t* job = state->job;
+
+    for (;;) {
+        pthread_mutex_lock(&state->lock);
+        int chunk = state->next_chunk++;
+        pthread_mutex_unlock(&state->lock);
+        if (chunk >= state->num_chunks) {
+            break;
+        }
+
+        long long start = (state->first_chunk + chunk) * SAMPLE_CHUNK_SIZE;
+        long long end = job->num_points - start < SAMPLE_CHUNK_SIZE ? job->num_points : start + SAMPLE_CHUNK_SIZE;
+        unsigned long long span = begin_trace_span();
+        state->results[chunk] = sample_chunk(job, start, end, state->window, chunk * SAMPLE_CHUNK_SIZE);
+        end_trace_span("sample_chunk", span, "points", end - start);
+    }
+    return NULL;
+}
+
+// Body of the started threads, their spans belong to the job of the calling thread
+static void* sampler_thread(void* arg) {
+    sampler_state_t* state = (sampler_state_t*)arg;
+    set_trace_job(state->trace_job);
+    set_trace_thread_name("sampler");
+    return sampler_worker(arg);
+}
+
+// Evaluating the chunks of one window, on num_threads threads including the calling one
+static void sample_window(sampler_state_t* state, pthread_t* threads, int num_threads) {
+    if (num_threads > state->num_chunks) {
+        num_threads = state->num_chunks;
+    }
+
+    // The calling thread works as well, a failed start only costs parallelism
+    int started = 0;
+    while (started < num_threads - 1) {
+        if (pthread_create(&threads[started], NULL, sampler_thread, state) != 0) {
+            DEBUG_PRINTF("[DEBUG]: Could not start sampling thread %d, continuing with %d\n",
+                   started + 2, started + 1);
+            break;
+        }
+        ++started;
+    }
+    sampler_worker(state);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+// Sampling on the fixed grid, possibly in parallel, one window of chunks at a time
+static bool stream_grid(const sample_job_t* job, sample_sink_t sink, void* context, sample_stats_t* stats) {
+    long long total_chunks = (job->num_points + SAMPLE_CHUNK_SIZE - 1) / SAMPLE_CHUNK_SIZE;
+    int num_threads = job->num_threads < 1 ? 1 : job->num_threads;
+    long long window_chunks = (long long)num_threads * SAMPLE_WINDOW_CHUNKS;
+    if (window_chunks > total_chunks) {
+        window_chunks = total_chunks > 0 ? total_chunks : 1;
+    }
+
+    sample_buffer_t own_window;
+    init_sample_buffer(&own_window);
+    sample_buffer_t* window = job->workspace != NULL ? job->workspace : &own_window;
+    sampler_state_t state;
+    state.job     = job;
+    state.window  = window;
+    state.trace_job = current_trace_job();
+    state.results = (chunk_result_t*)calloc(window_chunks, sizeof(chunk_result_t));
+    pthread_t* threads = (pthread_t*)malloc(num_threads * sizeof(pthread_t));
+    if (state.results == NULL || threads == NULL ||
+        !reserve_sample_buffer(window, (int)window_chunks * SAMPLE_CHUNK_SIZE)) {
+        free(state.results);
+        free(threads);
+        free_sample_buffer(&own_window);
+        return false;
+    }
+    pthread_mutex_init(&state.lock, NULL);
+
+    bool ok = true;
+    bool previous_visible = false; // last grid point of the previous window
+    for (long long first = 0; first < total_chunks && ok; first += window_chunks) {
+        state.first_chunk = first;
+        state.num_chunks  = (int)(total_chunks - first < window_chunks ? total_chunks - first : window_chunks);
+        state.next_chunk  = 0;
+        sample_window(&state, threads, num_threads);
+
+        // Compacting the chunks in grid order, joining the paths across chunk borders
+        int total = 0;
+        for (int chunk = 0; chunk < state.num_chunks; chunk++) {
+            int start = chunk * SAMPLE_CHUNK_SIZE;
+            int kept = state.results[chunk].kept;
+            if (state.results[chunk].first_visible) {
+                window->connected[start] = previous_visible;
+            }
+            if (total != start) {
+                memmove(window->x_values + total, window->x_values + start, kept * sizeof(double));
+                memmove(window->y_values + total, window->y_values + start, kept * sizeof(double));
+                memmove(window->connected + total, window->connected + start, kept * sizeof(bool));
+            }
+            total += kept;
+            previous_visible = state.results[chunk].last_visible;
+            stats->culled += state.results[chunk].culled;
+            // Culled points are NaN without being evaluated
+            stats->undefined += state.results[chunk].undefined - state.results[chunk].culled;
+        }
+
+        stats->kept += total;
+        if (total > 0 && !sink(context, window->x_values, window->y_values, window->connected, total)) {
+            stats->stopped = true;
+            ok = false;
+        }
+    }
+    stats->evaluations = job->num_points - stats->culled;
+
+    pthread_mutex_destroy(&state.lock);
+    free(state.results);
+    free(threads);
+    free_sample_buffer(&own_window);
+    return ok;
+}
+
+// State of the adaptive sampler
+typedef struct {
+    const sample_job_t* job;
+    sample_buffer_t* batch;      // points not yet handed to the sink
+    sample_sink_t    sink;
+    void*            context;
+    sample_stats_t*  stats;
+    double device_scale;         // device units per unit of y
+    bool   previous_visible;     // if the last evaluated point was kept
+    bool   ok;
+} adaptive_state_t;
+
+// Evaluating one x with the interpreter or the JIT
+static double evaluate_point(adaptive_state_t* state, double x) {
+    state->stats->evaluations++;
+    if (state->job->jit != NULL) {
+        return jit_evaluate(state->job->jit, x);
+    }
+    return evaluate_program(state->job->program, x);
+}
+
+// Handing the batch to the sink
+static void flush_batch(adaptive_state_t* state) {
+    sample_buffer_t* batch = state->batch;
+    if (batch->count > 0 && state->ok &&
+        !state->sink(state->context, batch->x_values, batch->y_values, batch->connected, batch->count)) {
+        state->stats->stopped = true;
+        state->ok = false;
+    }
+    batch->count = 0;
+}
+
+// Appending a point in x order, invisible ones only lift the pen
+static void emit_point(adaptive_state_t* state, double x, double y) {
+    sample_buffer_t* batch = state->batch;
+    bool visible = y >= state->job->y_min && y <= state->job->y_max;
+
+    if (visible && state->ok) {
+        if (batch->count == batch->capacity) {
+            flush_batch(state);
+        }
+        batch->x_values[batch->count]  = x;
+        batch->y_values[batch->count]  = y;
+        batch->connected[batch->count] = state->previous_visible;
+        batch->count++;
+        state->stats->kept++;
+    } else if (isnan(y)) {
+        state->stats->undefined++;
+    }
+    state->previous_visible = visible;
+}
+
+// Checking if a segment with midpoint value y_mid differs visibly from its chord
+static bool needs_refinement(const adaptive_state_t* state, double y_left, double y_mid, double y_right) {
+    int finite = isfinite(y_left) + isfinite(y_mid) + isfinite(y_right);
+    if (finite == 0) {
+        return false;  // undefined throughout
+    }
+    if (finite < 3) {
+        return true;   // an edge of the domain or a pole, worth locating
+    }
+
+    double y_min = state->job->y_min;
+    double y_max = state->job->y_max;
+    if ((y_left > y_max && y_mid > y_max && y_right > y_max) ||
+        (y_left < y_min && y_mid < y_min && y_right < y_min)) {
+        return false;  // off-screen on one side
+    }
+
+    double deviation = fabs(y_mid - 0.5 * (y_left + y_right)) * state->device_scale;
+    return !(deviation <= state->job->tolerance);
+}
+
+// Splitting [x_left, x_right] until it is straight enough, then emitting its midpoint and right end
+static void refine_segment(adaptive_state_t* state, double x_left, double y_left,
+                           double x_right, double y_right, int depth) {
+    // Nothing to refine in a segment proven invisible, its ends are already known
+    if (state->job->cull) {
+        Interval y = evaluate_program_interval(state->job->program, make_interval(x_left, x_right));
+        if (interval_outside(y, state->job->y_min, state->job->y_max)) {
+            state->stats->culled++;
+            emit_point(state, x_right, y_right);
+            return;
+        }
+    }
+
+    double x_mid = 0.5 * (x_left + x_right);
+    double y_mid = evaluate_point(state, x_mid);
+
+    if (depth < ADAPTIVE_MAX_DEPTH && needs_refinement(state, y_left, y_mid, y_right)) {
+        refine_segment(state, x_left, y_left, x_mid, y_mid, depth + 1);
+        refine_segment(state, x_mid, y_mid, x_right, y_right, depth + 1);
+    } else {
+        emit_point(state, x_mid, y_mid);
+        emit_point(state, x_right, y_right);
+    }
+}
+
+// Sampling adaptively, starting from 2^ADAPTIVE_MIN_DEPTH uniform segments
+static bool stream_adaptive(const sample_job_t* job, sample_sink_t sink, void* context, sample_stats_t* stats) {
+    sample_buffer_t own_batch;
+    init_sample_buffer(&own_batch);
+    sample_buffer_t* batch = job->workspace != NULL ? job->workspace : &own_batch;
+    if (!reserve_sample_buffer(batch, SAMPLE_CHUNK_SIZE)) {
+        return false;
+    }
+    batch->count = 0;
+    adaptive_state_t state = {job, batch, sink, context, stats, GRAPH_SCALE / (job->y_max - job->y_min), false, true};
+
+    int segments = 1 << ADAPTIVE_MIN_DEPTH;
+    double width = (job->x_max - job->x_min) / segments;
+
+    // A -0 limit gives +0, the optimizer relies on it
+    double x_left = job->x_min + 0.0;
+    double y_left = evaluate_point(&state, x_left);
+    emit_point(&state, x_left, y_left);
+
+    for (int i = 1; i <= segments && state.ok; i++) {
+        double x_right = i == segments ? job->x_max : job->x_min + i * width;
+        double y_right = evaluate_point(&state, x_right);
+        refine_segment(&state, x_left, y_left, x_right, y_right, ADAPTIVE_MIN_DEPTH);
+        x_left = x_right;
+        y_left = y_right;
+    }
+    flush_batch(&state);
+
+    free_sample_buffer(&own_batch);
+    return state.ok;
+}
+
+bool stream_samples(const sample_job_t* job, sample_sink_t sink, void* context, sample_stats_t* stats) {
+    sample_stats_t unused;
+    if (stats == NULL) {
+        stats = &unused;
+    }
+    memset(stats, 0, sizeof(sample_stats_t));
+    if (job == NULL || sink == NULL || (job->program == NULL && job->jit == NULL)) {
+        return false;
+    }
+
+    if (job->tolerance > 0) {
+        unsigned long long span = begin_trace_span();
+        bool ok = stream_adaptive(job, sink, context, stats);
+        end_trace_span("sample_adaptive", span, "points", stats->evaluations);
+        return ok;
+    }
+    if (job->num_points < 0) {
+        return false;
+    }
+    return stream_grid(job, sink, context, stats);
+}
+
+// Sink appending the batches to a sample_buffer_t
+static bool collect_batch(void* context, const double* x_values, const double* y_values,
+                          const bool* connected, int count) {
+    sample_buffer_t* buffer = (sample_buffer_t*)context;
+    if (count > INT_MAX - buffer->count) {
+        return false;
+    }
+    if (buffer->count + count > buffer->capacity) {
+        int capacity = buffer->capacity > INT_MAX / 2 ? INT_MAX : 2 * buffer->capacity;
+        if (capacity < buffer->count + count) {
+            capacity = buffer->count + count;
+        }
+        if (!reserve_sample_buffer(buffer, capacity)) {
+            return false;
+        }
+    }
+
+    memcpy(buffer->x_values + buffer->count, x_values, count * sizeof(double));
+    memcpy(buffer->y_values + buffer->count, y_values, count * sizeof(double));
+    memcpy(buffer->connected + buffer->count, connected, count * sizeof(bool));
+    buffer->count += count;
+    return true;
+}
+
+int sample_expression(const sample_job_t* job, sample_buffer_t* buffer) {
+    if (buffer == NULL) {
+        return -1;
+    }
+
+    // On the grid the number of points is known, at most all of them are kept
+    buffer->count = 0;
+    if (job != NULL && job->tolerance <= 0 && job->num_points <= INT_MAX &&
+        !reserve_sample_buffer(buffer, (int)job->num_points)) {
+        return -1;
+    }
+
+    sample_stats_t stats;
+    bool ok = stream_samples(job, collect_batch, buffer, &stats);
+    buffer->evaluations = stats.evaluations;
+    buffer->culled      = stats.culled;
+    return ok ? buffer->count : -1;
+}
@@ -0,0 +1,116 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "bytecode.h"
+#include "jit.h"
+
+// Upper bound for --threads
+#define SAMPLER_MAX_THREADS 256
+
+// Points claimed by a thread at once, a multiple of SAMPLE_BLOCK_SIZE
+#define SAMPLE_CHUNK_SIZE (64 * 1024)
+
+// Chunks per thread evaluated before the kept points are handed on, this bounds the memory
+#define SAMPLE_WINDOW_CHUNKS 2
+
+// Smallest run of grid points the interval test tries to cull
+#define CULL_MIN_POINTS 32
+
+// Adaptive sampling: allowed deviation from a straight segment in device units (points)
+#define ADAPTIVE_TOLERANCE 0.05
+// Every range is split into at least 2^ADAPTIVE_MIN_DEPTH segments, so narrow features are seen
+#define ADAPTIVE_MIN_DEPTH 8
+// and into at most 2^ADAPTIVE_MAX_DEPTH, which bounds the work near poles and jumps
+#define ADAPTIVE_MAX_DEPTH 20
+
+// Sampled points, growing as needed
+typedef struct {
+    double*   x_values;
+    double*   y_values;
+    bool*     connected;   // false where the pen is lifted before the point
+    int       count;       // number of kept points
+    int       capacity;
+    long long evaluations; // number of evaluated x values
+    long long culled;      // number of samples skipped by the interval test
+} sample_buffer_t;
+
+// Sampling of a compiled expression over [x_min, x_max]
+typedef struct {
+    const ExpressionProgram* program; // interpreted if jit is NULL
+    const JitProgram*        jit;     // native code, may be NULL
+    double x_min;                     // x of the first point
+    double x_max;                     // end of the range
+    double step;                      // distance of the grid points
+    double y_min;                     // points outside [y_min, y_max] are dropped
+    double y_max;
+    long long num_points;             // number of grid points, not walked when adaptive
+    int    num_threads;               // 1 evaluates on the calling thread
+    double tolerance;                 // > 0 samples adaptively instead of on the grid
+    bool   cull;                      // skip ranges proven invisible by interval arithmetic
+    sample_buffer_t* workspace;       // window buffer kept between runs, NULL allocates one per run
+} sample_job_t;
+
+
+// Receiver of the kept points, called with consecutive batches in x order; connected[0]
+// refers to the last point of the previous batch. Returning false stops the sampling.
+typedef bool (*sample_sink_t)(void* context, const double* x_values, const double* y_values,
+                              const bool* connected, int count);
+
+// Counters of a sampling run
+typedef struct {
+    long long kept;        // number of points handed to the sink
+    long long evaluations; // number of evaluated x values
+    long long culled;      // number of samples skipped by the interval test
+    long long undefined;   // number of evaluated points without a value (NaN)
+    bool      stopped;     // the sink refused a batch
+} sample_stats_t;
+
+// Initializing an empty buffer
+void init_sample_buffer(sample_buffer_t* buffer);
+
+// Making room for at least `capacity` points, the content is kept
+bool reserve_sample_buffer(sample_buffer_t* buffer, int capacity);
+
+// Releasing the arrays of a buffer
+void free_sample_buffer(sample_buffer_t* buffer);
+
+/**
+ * @brief Evaluates the expression over the range and streams the visible points.
+ *
+ * @param job Sampling parameters
+ * @param sink Receiver of the kept points in x order
+ * @param context Passed to the sink
+ * @param stats Receives the counters, may be NULL
+ * @return bool False on invalid arguments, allocation failure or when the sink stops.
+ *
+ * On the grid every x is x_min + i*step, so chunks are independent and the
+ * kept points come out in grid order for any number of threads. Threads
+ * claim SAMPLE_CHUNK_SIZE chunks in turn, the calling thread included. After
+ * every window of SAMPLE_WINDOW_CHUNKS chunks per thread the kept points go
+ * to the sink, so the memory used does not grow with the range.
+ *
+ * With a tolerance the range is split recursively, between the minimum and
+ * maximum depth, wherever the midpoint of a segment deviates from the chord
+ * by more than the tolerance in device units. Adaptive sampling runs on the
+ * calling thread and hands on batches of SAMPLE_CHUNK_SIZE points.
+ *
+ * With culling, ranges whose interval enclosure lies outside [y_min, y_max]
+ * or is empty (undefined throughout) are not evaluated. The kept points are
+ * the same as without culling.
+ */
+bool stream_samples(const sample_job_t* job, sample_sink_t sink, void* context, sample_stats_t* stats);
+
+/**
+ * @brief Evaluates the expression over the range and keeps the visible points.
+ *
+ * @param job Sampling parameters
+ * @param buffer Buffer receiving the kept points in x order
+ * @return int Number of kept points, -1 on invalid arguments or allocation failure.
+ *
+ * Collects what stream_samples() produces, for callers that need all points at once.
+ */
+int sample_expression(const sample_job_t* job, sample_buffer_t* buffer);
+
+#endif // SAMPLER_H
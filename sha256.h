@@ -0,0 +1,25 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Digest size in bytes
+#define SHA256_DIGEST_SIZE 32
+
+// Incremental SHA-256 state (FIPS 180-4)
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;     // bytes hashed so far
+    unsigned char block[64];
+    size_t   used;       // bytes waiting in block
+} sha256_t;
+
+void sha256_init(sha256_t* hash);
+
+void sha256_update(sha256_t* hash, const void* data, size_t size);
+
+// Finishing the hash, the state must be initialized again before reuse
+void sha256_final(sha256_t* hash, unsigned char digest[SHA256_DIGEST_SIZE]);
+
+#endif // SHA256_H
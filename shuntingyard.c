@@ -6,6 +6,7 @@
 #include "shuntingyard.h"
 #include "defs.h"
 #include "parser_utils.h"
+#include "function_registry.h"
 
 
 
@@ -185,12 +186,12 @@ bool parse_expression(const char* expr, TokenQueue* output_queue) {
     for (int i = 0; expr[i] != END_STRING_CHAR; i++) {
         char ch = expr[i];
         if (isdigit(ch) || ch == DECIMAL_POINT) {  // Number
-            Token token = {TOKEN_NUMBER, atof(&expr[i]), NUMBER_ZERO, EMPTY_STRING};
+            Token token = {TOKEN_NUMBER, atof(&expr[i]), NUMBER_ZERO, EMPTY_STRING, NO_FUNCTION_ID};
             enqueue_token(output_queue, token);
             while (isdigit(expr[i]) || expr[i] == DECIMAL_POINT) i++;  // Skip the rest of the numbers
             i--;
         } else if (ch == VALID_VARIABLE) {  // Variable
-            Token token = {TOKEN_VARIABLE, NUMBER_ZERO, NUMBER_ZERO, EMPTY_STRING};
+            Token token = {TOKEN_VARIABLE, NUMBER_ZERO, NUMBER_ZERO, EMPTY_STRING, NO_FUNCTION_ID};
             enqueue_token(output_queue, token);
         } else if (isalpha(ch)) {  // Function discovered
             char func[10] = {0};
@@ -198,21 +199,22 @@ bool parse_expression(const char* expr, TokenQueue* output_queue) {
             while (isalpha(expr[i]) && j < 9) func[j++] = expr[i++];
             func[j] = END_STRING_CHAR;
             i--;
-            if (is_supported_function(func)) {
-                Token token = {TOKEN_FUNCTION, NUMBER_ZERO, NUMBER_ZERO, EMPTY_STRING};
+            int func_id = find_function(func);
+            if (func_id >= 0) {
+                Token token = {TOKEN_FUNCTION, NUMBER_ZERO, NUMBER_ZERO, EMPTY_STRING, func_id};
                 strcpy(token.func, func);
                 push_token(&op_stack, token);  // Adding a function to the stack
             } else {
                 return false;  // Function not supported
             }
         } else if (ch == OPERATOR_MINUS) {  // Checking for unary or binary minus
-            if (i == 0 || expr[i - 1] == TOKEN_LEFT_PAREN || is_binary_operator(expr[i - 1])) {
+            if (i == 0 || expr[i - 1] == OPERATOR_LEFT_PAREN || is_binary_operator(expr[i - 1])) {
                 // If the first character is after '(' or operator, then it is unary minus
-                Token unary_minus_token = {TOKEN_OPERATOR, NUMBER_ZERO, OPERATOR_UNARY_MINUS, EMPTY_STRING};
+                Token unary_minus_token = {TOKEN_OPERATOR, NUMBER_ZERO, OPERATOR_UNARY_MINUS, EMPTY_STRING, NO_FUNCTION_ID};
                 push_token(&op_stack, unary_minus_token);
             } else {
                 // Otherwise it's a binary minus
-                Token op_token = {TOKEN_OPERATOR, NUMBER_ZERO, ch, EMPTY_STRING};
+                Token op_token = {TOKEN_OPERATOR, NUMBER_ZERO, ch, EMPTY_STRING, NO_FUNCTION_ID};
                 Token top_token;
                 while (peek_token(&op_stack, &top_token) &&
                        top_token.type == TOKEN_OPERATOR &&
@@ -223,7 +225,7 @@ bool parse_expression(const char* expr, TokenQueue* output_queue) {
                 push_token(&op_stack, op_token);
             }
         } else if (is_binary_operator(ch)) {  // Operator
-            Token op_token = {TOKEN_OPERATOR, NUMBER_ZERO, ch, EMPTY_STRING};
+            Token op_token = {TOKEN_OPERATOR, NUMBER_ZERO, ch, EMPTY_STRING, NO_FUNCTION_ID};
             Token top_token;
             while (peek_token(&op_stack, &top_token) &&
                    top_token.type == TOKEN_OPERATOR &&
@@ -233,7 +235,7 @@ bool parse_expression(const char* expr, TokenQueue* output_queue) {
             }
             push_token(&op_stack, op_token);
         } else if (ch == OPERATOR_LEFT_PAREN) {  // Left bracket
-            Token token = {TOKEN_LEFT_PAREN, NUMBER_ZERO, NUMBER_ZERO, EMPTY_STRING};
+            Token token = {TOKEN_LEFT_PAREN, NUMBER_ZERO, NUMBER_ZERO, EMPTY_STRING, NO_FUNCTION_ID};
             push_token(&op_stack, token);
         } else if (ch == OPERATOR_RIGHT_PAREN) {  // Right bracket
             Token top_token;
@@ -285,57 +287,6 @@ double calculate_operator(char op, double lhs, double rhs) {
     }
 }
 
-// FIXME may need to be changed to a more elegant solution later, without so many if else
-// Calculate the result for a supported function
-double calculate_function(const char* func, double arg) {
-    if (func == NULL) {
-        return NAN;
-    }
-
-    if (strcmp(func, FUNC_ABS) == 0) {
-        return fabs(arg);
-    } else if (strcmp(func, FUNC_EXP) == 0) {
-        return exp(arg);
-    } else if (strcmp(func, FUNC_LN) == 0) {
-        if (arg <= 0) {
-            return NAN;
-        }
-        return log(arg); // natural logarithm
-    } else if (strcmp(func, FUNC_LOG) == 0) {
-        if (arg <= 0) {
-            return NAN;
-        }
-        return log10(arg); // common logarithm
-    } else if (strcmp(func, FUNC_SIN) == 0) {
-        return sin(arg);
-    } else if (strcmp(func, FUNC_COS) == 0) {
-        return cos(arg);
-    } else if (strcmp(func, FUNC_TAN) == 0) {
-        return tan(arg);
-    } else if (strcmp(func, FUNC_ASIN) == 0) {
-        if (arg < -1 || arg > 1) {
-            return NAN;
-        }
-        return asin(arg);
-    } else if (strcmp(func, FUNC_ACOS) == 0) {
-        if (arg < -1 || arg > 1) {
-            return NAN;
-        }
-        return acos(arg);
-    } else if (strcmp(func, FUNC_ATAN) == 0) {
-        return atan(arg);
-    } else if (strcmp(func, FUNC_SINH) == 0) {
-        return sinh(arg);
-    } else if (strcmp(func, FUNC_COSH) == 0) {
-        return cosh(arg);
-    } else if (strcmp(func, FUNC_TANH) == 0) {
-        return tanh(arg);
-    } else {
-        fprintf(stderr, "Error: Unsupported function '%s'.\n", func);
-        return NAN; // Return NaN for unsupported features
-    }
-}
-
 // Calculating the result of an expression based on the RPN
 double evaluate_expression(const TokenQueue* queue, double x) {
     if (queue == NULL) {
@@ -353,33 +304,35 @@ double evaluate_expression(const TokenQueue* queue, double x) {
         if (token.type == TOKEN_NUMBER) {
             push_token(&value_stack, token);
         } else if (token.type == TOKEN_VARIABLE) {
-            Token var_token = {TOKEN_NUMBER, x, NUMBER_ZERO, EMPTY_STRING};
+            Token var_token = {TOKEN_NUMBER, x, NUMBER_ZERO, EMPTY_STRING, NO_FUNCTION_ID};
             push_token(&value_stack, var_token);
         } else if (token.type == TOKEN_OPERATOR) {
             if (token.op == OPERATOR_UNARY_MINUS) {
-                Token operand;
+                Token operand = {TOKEN_NUMBER, NAN, NUMBER_ZERO, EMPTY_STRING, NO_FUNCTION_ID};
                 pop_token(&value_stack, &operand);
                 double result = calculate_operator(token.op, 0, operand.value); // Unary minus works with one operand.
-                Token result_token = {TOKEN_NUMBER, result, NUMBER_ZERO, EMPTY_STRING};
+                Token result_token = {TOKEN_NUMBER, result, NUMBER_ZERO, EMPTY_STRING, NO_FUNCTION_ID};
                 push_token(&value_stack, result_token);
             } else {
-                Token rhs, lhs;
+                Token rhs = {TOKEN_NUMBER, NAN, NUMBER_ZERO, EMPTY_STRING, NO_FUNCTION_ID};
+                Token lhs = {TOKEN_NUMBER, NAN, NUMBER_ZERO, EMPTY_STRING, NO_FUNCTION_ID};
                 pop_token(&value_stack, &rhs);
                 pop_token(&value_stack, &lhs);
                 double result = calculate_operator(token.op, lhs.value, rhs.value);
-                Token result_token = {TOKEN_NUMBER, result, NUMBER_ZERO, EMPTY_STRING};
+                Token result_token = {TOKEN_NUMBER, result, NUMBER_ZERO, EMPTY_STRING, NO_FUNCTION_ID};
                 push_token(&value_stack, result_token);
             }
         } else if (token.type == TOKEN_FUNCTION) {
-            Token arg;
+            Token arg = {TOKEN_NUMBER, NAN, NUMBER_ZERO, EMPTY_STRING, NO_FUNCTION_ID};
             pop_token(&value_stack, &arg);
-            double result = calculate_function(token.func, arg.value);
-            Token result_token = {TOKEN_NUMBER, result, NUMBER_ZERO, EMPTY_STRING};
+            double result = apply_function(token.func_id, arg.value);
+            Token result_token = {TOKEN_NUMBER, result, NUMBER_ZERO, EMPTY_STRING, NO_FUNCTION_ID};
             push_token(&value_stack, result_token);
         }
     }
 
-    Token result_token;
+    // Missing operands of a malformed queue evaluate to NaN
+    Token result_token = {TOKEN_NUMBER, NAN, NUMBER_ZERO, EMPTY_STRING, NO_FUNCTION_ID};
     pop_token(&value_stack, &result_token);
 
     clear_token_stack(&value_stack);
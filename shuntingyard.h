@@ -8,6 +8,8 @@
 #include <math.h>
 
 #define MAX_FUNC_NAME_LENGTH 8
+// func_id of tokens that are not functions, as find_function() reports an unknown name
+#define NO_FUNCTION_ID (-1)
 
 // Token Type Definitions
 typedef enum {
@@ -24,6 +26,7 @@ typedef struct Token {
     double value; // for numbers
     char op;      // for operators
     char func[MAX_FUNC_NAME_LENGTH]; // for functions
+    int func_id;  // registry id for functions, resolved by the parser
 } Token;
 
 // Node for token queue
@@ -80,6 +83,9 @@ bool parse_expression(const char* expr, TokenQueue* output_queue);
 //Calculating the result of an expression based on the RPN
 double evaluate_expression(const TokenQueue* queue, double x);
 
+// Calculate the result for a given operator
+double calculate_operator(char op, double lhs, double rhs);
+
 // Getting operator priority
 int get_operator_precedence(char op);
 
@@ -0,0 +1,39 @@
+#include <stdlib.h>
+#include <time.h>
+#include "timing.h"
+
+double monotonic_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+double process_cpu_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+double thread_cpu_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+void sort_durations(double* values, int count) {
+    qsort(values, count, sizeof(double), compare_doubles);
+}
+
+double duration_percentile(const double* sorted, int count, double p) {
+    if (count <= 0) {
+        return 0;
+    }
+    int rank = (int)(p / 100 * count + 0.999999);
+    return sorted[rank < 1 ? 0 : rank > count ? count - 1 : rank - 1];
+}
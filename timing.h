@@ -0,0 +1,35 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <time.h>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+
+// Cheap tick counter for profiling short sections: the time stamp counter on x86-64, nanoseconds elsewhere
+static inline unsigned long long profile_ticks(void) {
+#if defined(__x86_64__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+#endif
+}
+
+// Seconds on a monotonic clock, for measuring durations
+double monotonic_seconds(void);
+
+// CPU seconds used by all threads of the process
+double process_cpu_seconds(void);
+
+// CPU seconds used by the calling thread
+double thread_cpu_seconds(void);
+
+// Sorting durations in ascending order
+void sort_durations(double* values, int count);
+
+// Nearest-rank percentile p (0 to 100) of sorted durations, 0 if there are none
+double duration_percentile(const double* sorted, int count, double p);
+
+#endif // TIMING_H
@@ -0,0 +1,203 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "trace.h"
+
+bool trace_enabled = false;
+
+// One complete event
+typedef struct {
+    const char*        name;
+    const char*        label; // name of value, NULL for none
+    unsigned long long start;
+    unsigned long long end;
+    long long          value;
+    int                job;
+} trace_event_t;
+
+// Block of events of one buffer
+typedef struct trace_block {
+    trace_event_t       events[TRACE_BLOCK_EVENTS];
+    int                 count;
+    struct trace_block* next;
+} trace_block_t;
+
+// Events of one track, written only by the thread holding the buffer
+typedef struct trace_buffer {
+    int                  track;   // tid in the trace file
+    const char*          name;    // thread name of the track, NULL for none
+    trace_block_t*       first;
+    trace_block_t*       last;
+    long long            dropped; // events lost to allocation failures
+    struct trace_buffer* next;    // in the list of all buffers
+    struct trace_buffer* next_free;
+} trace_buffer_t;
+
+// Buffers of all threads, the lock only guards handing them out and taking them back
+static struct {
+    const char*        path;
+    unsigned long long origin;
+    pthread_key_t      key;
+    pthread_mutex_t    lock;
+    trace_buffer_t*    all;
+    trace_buffer_t*    free;
+    int                tracks;
+} trace = {NULL, 0, 0, PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0};
+
+static _Thread_local trace_buffer_t* thread_buffer = NULL;
+static _Thread_local int thread_job = 0;
+
+unsigned long long trace_clock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long)now.tv_sec * 1000000000ULL + (unsigned long long)now.tv_nsec;
+}
+
+// Taking back the buffer of an exiting thread
+static void release_buffer(void* buffer) {
+    pthread_mutex_lock(&trace.lock);
+    ((trace_buffer_t*)buffer)->next_free = trace.free;
+    trace.free = (trace_buffer_t*)buffer;
+    pthread_mutex_unlock(&trace.lock);
+}
+
+// Buffer of the calling thread, one released by a thread of the same name or a new track; NULL if memory is short
+static trace_buffer_t* acquire_buffer(const char* name) {
+    if (thread_buffer != NULL) {
+        return thread_buffer;
+    }
+
+    pthread_mutex_lock(&trace.lock);
+    trace_buffer_t** link = &trace.free;
+    while (*link != NULL && (*link)->name != name) {
+        link = &(*link)->next_free;
+    }
+    trace_buffer_t* buffer = *link;
+    if (buffer != NULL) {
+        *link = buffer->next_free;
+    } else if ((buffer = (trace_buffer_t*)calloc(1, sizeof(trace_buffer_t))) != NULL) {
+        buffer->track = ++trace.tracks;
+        buffer->name  = name;
+        buffer->next  = trace.all;
+        trace.all     = buffer;
+    }
+    pthread_mutex_unlock(&trace.lock);
+
+    if (buffer != NULL) {
+        pthread_setspecific(trace.key, buffer);
+        thread_buffer = buffer;
+    }
+    return buffer;
+}
+
+void record_trace_span(const char* name, unsigned long long start, const char* label, long long value) {
+    unsigned long long end = trace_clock();
+    trace_buffer_t* buffer = acquire_buffer(NULL);
+    if (buffer == NULL) {
+        return;
+    }
+
+    trace_block_t* block = buffer->last;
+    if (block == NULL || block->count == TRACE_BLOCK_EVENTS) {
+        trace_block_t* next = (trace_block_t*)malloc(sizeof(trace_block_t));
+        if (next == NULL) {
+            buffer->dropped++;
+            return;
+        }
+        next->count = 0;
+        next->next  = NULL;
+        if (block != NULL) {
+            block->next = next;
+        } else {
+            buffer->first = next;
+        }
+        buffer->last = block = next;
+    }
+
+    trace_event_t* event = &block->events[block->count++];
+    event->name  = name;
+    event->label = label;
+    event->start = start;
+    event->end   = end;
+    event->value = value;
+    event->job   = thread_job;
+}
+
+void set_trace_job(int job) {
+    thread_job = job;
+}
+
+int current_trace_job(void) {
+    return thread_job;
+}
+
+void set_trace_thread_name(const char* name) {
+    if (trace_enabled) {
+        trace_buffer_t* buffer = acquire_buffer(name);
+        if (buffer != NULL) {
+            buffer->name = name;
+        }
+    }
+}
+
+// Microseconds since the origin, the unit of the trace file
+static double trace_microseconds(unsigned long long time) {
+    return time > trace.origin ? (time - trace.origin) / 1e3 : 0.0;
+}
+
+// Writing every buffer at exit, the other threads have finished by then
+static void flush_trace(void) {
+    trace_enabled = false;
+    FILE* file = fopen(trace.path, "w");
+    if (file == NULL) {
+        perror("Failed to write the trace");
+        return;
+    }
+
+    int pid = (int)getpid();
+    long long dropped = 0;
+    bool first = true;
+    fprintf(file, "{\"traceEvents\": [\n");
+    for (trace_buffer_t* buffer = trace.all; buffer != NULL; buffer = buffer->next) {
+        if (buffer->name != NULL) {
+            fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, "
+                          "\"args\": {\"name\": \"%s\"}}", first ? "" : ",\n", pid, buffer->track, buffer->name);
+            first = false;
+        }
+        for (trace_block_t* block = buffer->first; block != NULL; block = block->next) {
+            for (int i = 0; i < block->count; i++) {
+                const trace_event_t* event = &block->events[i];
+                fprintf(file, "%s{\"name\": \"%s\", \"cat\": \"render\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, "
+                              "\"pid\": %d, \"tid\": %d, \"args\": {\"job\": %d",
+                        first ? "" : ",\n", event->name, trace_microseconds(event->start),
+                        (event->end - event->start) / 1e3, pid, buffer->track, event->job);
+                if (event->label != NULL) {
+                    fprintf(file, ", \"%s\": %lld", event->label, event->value);
+                }
+                fprintf(file, "}}");
+                first = false;
+            }
+        }
+        dropped += buffer->dropped;
+    }
+    fprintf(file, "\n], \"displayTimeUnit\": \"ms\", \"otherData\": {\"dropped_events\": %lld}}\n", dropped);
+    if (fclose(file) != 0) {
+        perror("Failed to write the trace");
+    }
+}
+
+bool start_trace(const char* path, unsigned long long started) {
+    if (path == NULL || pthread_key_create(&trace.key, release_buffer) != 0) {
+        return false;
+    }
+    trace.path   = path;
+    trace.origin = started;
+    if (atexit(flush_trace) != 0) {
+        return false;
+    }
+    trace_enabled = true;
+    return true;
+}
@@ -0,0 +1,53 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+
+// Events per block of a thread buffer, blocks are chained as the buffer grows
+#define TRACE_BLOCK_EVENTS 4096
+
+// Whether --trace is recording, set once before any thread starts
+extern bool trace_enabled;
+
+// Nanoseconds on the monotonic clock of the trace
+unsigned long long trace_clock(void);
+
+// Start of a span, 0 when not tracing
+static inline unsigned long long begin_trace_span(void) {
+    return trace_enabled ? trace_clock() : 0;
+}
+
+// Recording a span from start until now on the calling thread, label names the value or is NULL
+void record_trace_span(const char* name, unsigned long long start, const char* label, long long value);
+
+// Ending a span, nothing is recorded when not tracing; name and label must be static strings
+static inline void end_trace_span(const char* name, unsigned long long start, const char* label, long long value) {
+    if (trace_enabled) {
+        record_trace_span(name, start, label, value);
+    }
+}
+
+// Job id attached to the spans of the calling thread, 0 outside batch and daemon jobs
+void set_trace_job(int job);
+int current_trace_job(void);
+
+// Naming the track of the calling thread, a static string; call it before the first span of the thread
+void set_trace_thread_name(const char* name);
+
+/**
+ * @brief Starts recording spans for a Chrome trace-event file.
+ *
+ * @param path File written when the process exits
+ * @param started trace_clock() at the start of the process, for the first span
+ * @return bool False if recording cannot start.
+ *
+ * Every thread appends complete ("X") events to its own buffer without
+ * locking. A buffer is handed out on the first span of a thread and taken
+ * back when the thread exits, so the short-lived sampling threads reuse the
+ * tracks of their predecessors. At exit all buffers are written as one JSON
+ * object, with the job id and the value of each span in its arguments, which
+ * chrome://tracing and Perfetto open directly.
+ */
+bool start_trace(const char* path, unsigned long long started);
+
+#endif // TRACE_H